@@ -1,21 +1,29 @@
 import logging
 import string
 
-from esphome import core
+from esphome import automation, core
 import esphome.codegen as cg
 from esphome.components import binary_sensor, esp32, event, lock, sensor, text_sensor
 import esphome.config_validation as cv
+import esphome.final_validate as fv
 from esphome.const import (
     CONF_ADDRESS,
     CONF_ID,
+    CONF_INTERVAL,
+    CONF_TRIGGER_ID,
     CONF_UUID,
     DEVICE_CLASS_BATTERY,
     DEVICE_CLASS_CONNECTIVITY,
+    DEVICE_CLASS_DURATION,
     DEVICE_CLASS_VOLTAGE,
+    ENTITY_CATEGORY_DIAGNOSTIC,
     STATE_CLASS_MEASUREMENT,
+    STATE_CLASS_TOTAL_INCREASING,
+    UNIT_MILLISECOND,
     UNIT_PERCENT,
     UNIT_VOLT,
 )
+from esphome.components.esp32.const import VARIANT_ESP32, VARIANT_ESP32S3
 from esphome.core import CORE, ID
 from esphome.types import ConfigType
 
@@ -35,17 +43,22 @@ CONF_POLICY = "policy"
 sesame_server_ns = cg.esphome_ns.namespace("sesame_server")
 SesameServerComponent = sesame_server_ns.class_("SesameServerComponent", cg.PollingComponent)
 SesameTrigger = sesame_server_ns.class_("SesameTrigger")
+SesameRouteTrigger = sesame_server_ns.class_("SesameRouteTrigger", automation.Trigger.template(cg.std_string))
 StatusLockWrapper = sesame_server_ns.class_("StatusLockWrapper")
 SesameServerConnectCheckEntry = sesame_server_ns.class_("SesameServerConnectCheckEntry")
-NimBLEAddress = cg.global_ns.class_("NimBLEAddress")
-ble_addr_t = cg.global_ns.class_("ble_addr_t")
-BLE_ADDR_RANDOM = cg.global_ns.namespace("BLE_ADDR_RANDOM")
-BLE_ADDR_PUBLIC = cg.global_ns.namespace("BLE_ADDR_PUBLIC")
+BLE_ADDR_RANDOM_VALUE = 1
 connect_check_policy_t = sesame_server_ns.enum("connect_check_policy_t", True)
 POLICY_VALUES = {
     "allow": connect_check_policy_t.allow,
     "deny": connect_check_policy_t.deny,
 }
+connection_profile_t = sesame_server_ns.enum("connection_profile_t", True)
+CONNECTION_PROFILES = {
+    "none": connection_profile_t.none,
+    "low_latency": connection_profile_t.low_latency,
+    "balanced": connection_profile_t.balanced,
+    "low_power": connection_profile_t.low_power,
+}
 
 
 CONF_HISTORY_TAG = "history_tag"
@@ -56,7 +69,69 @@ CONF_BATTERY_PCT = "battery_pct"
 CONF_SCALED_VOLTAGE2 = "scaled_voltage2"
 CONF_BATTERY_PCT2 = "battery_pct2"
 CONF_EXTRA = "extra"
+CONF_SWITCH_STATE = "switch_state"
+CONF_ROUTES = "routes"
+CONF_EVENT_TYPE = "event_type"
 CONF_VERSION_TAG = "version_tag"
+CONF_PUBLISH_CHANGES_ONLY = "publish_changes_only"
+CONF_VOLTAGE_DEADBAND = "voltage_deadband"
+CONF_BATTERY_PCT_DEADBAND = "battery_pct_deadband"
+CONF_LOCK_STATE_COALESCE = "lock_state_coalesce"
+CONF_DEDUP_WINDOW = "dedup_window"
+CONF_DIAGNOSTICS_INTERVAL = "diagnostics_interval"
+CONF_LATENCY_P50 = "latency_p50"
+CONF_LATENCY_P99 = "latency_p99"
+CONF_LATENCY_MAX = "latency_max"
+LATENCY_SENSORS = [CONF_LATENCY_P50, CONF_LATENCY_P99, CONF_LATENCY_MAX]
+CONF_TRIGGER_LATENCY_HISTOGRAM = "trigger_latency_histogram"
+CONF_SESSION_COUNT = "session_count"
+CONF_SESSION_HIGH_WATER = "session_high_water"
+CONF_AUTHENTICATION_COUNT = "authentication_count"
+CONF_DISCONNECT_COUNT = "disconnect_count"
+CONF_CONNECT_DENIED_COUNT = "connect_denied_count"
+SESSION_SENSORS = [CONF_SESSION_COUNT, CONF_SESSION_HIGH_WATER]
+CONF_UNLISTED_IDLE_TIMEOUT = "unlisted_idle_timeout"
+CONF_UNLISTED_EVICTION_IDLE = "unlisted_eviction_idle"
+CONF_CONNECTION_PROFILE = "connection_profile"
+CONF_AGGREGATE_EVENT = "aggregate_event"
+CONF_AGGREGATE_SENSOR_INTERVAL = "aggregate_sensor_interval"
+CONF_UNLISTED_CONNECTION_PROFILE = "unlisted_connection_profile"
+CONF_RESERVED_TRIGGER_SESSIONS = "reserved_trigger_sessions"
+CONF_ADVERTISING = "advertising"
+CONF_FAST_INTERVAL = "fast_interval"
+CONF_FAST_DURATION = "fast_duration"
+CONF_SLOW_INTERVAL = "slow_interval"
+CONF_PAUSE_WHEN_FULL = "pause_when_full"
+CONF_LOCK_STATE_RETRY = "lock_state_retry"
+CONF_TRACE_SIZE = "trace_size"
+CONF_EARLY_START = "early_start"
+CONF_HOLD_TIMEOUT = "hold_timeout"
+CONF_QUEUE_SIZE = "queue_size"
+CONF_CLIENT_WINDOW = "client_window"
+CONF_IDLE = "idle"
+CONF_MAX_WAIT = "max_wait"
+CONF_BLACKOUT = "blackout"
+CONF_EVENT_HISTORY_SIZE = "event_history_size"
+CONF_MAX_ATTEMPTS = "max_attempts"
+CONF_INITIAL_BACKOFF = "initial_backoff"
+CONF_MAX_BACKOFF = "max_backoff"
+CONF_LOCK_STATE_RETRY_COUNT = "lock_state_retry_count"
+CONF_LOCK_STATE_FAILURE_COUNT = "lock_state_failure_count"
+CONF_EVENT_DRIVEN_LOOP = "event_driven_loop"
+CONF_WORKER_TASK = "worker_task"
+CONF_CORE = "core"
+CONF_PRIORITY = "priority"
+CONF_STACK_SIZE = "stack_size"
+CONF_LOOP_WAKEUP_COUNT = "loop_wakeup_count"
+CONF_LOOP_TIME = "loop_time"
+COUNTER_SENSORS = [
+    CONF_AUTHENTICATION_COUNT,
+    CONF_DISCONNECT_COUNT,
+    CONF_CONNECT_DENIED_COUNT,
+    CONF_LOCK_STATE_RETRY_COUNT,
+    CONF_LOCK_STATE_FAILURE_COUNT,
+    CONF_LOOP_WAKEUP_COUNT,
+]
 
 
 def is_hex_string(str, valid_len):
@@ -109,6 +184,22 @@ def warn_trigger_type_deprecated(config: ConfigType) -> ConfigType:
     return config
 
 
+def validate_deadbands(config: ConfigType) -> ConfigType:
+    if not config[CONF_PUBLISH_CHANGES_ONLY] and (CONF_VOLTAGE_DEADBAND in config or CONF_BATTERY_PCT_DEADBAND in config):
+        raise cv.Invalid(f"'{CONF_VOLTAGE_DEADBAND}' and '{CONF_BATTERY_PCT_DEADBAND}' require '{CONF_PUBLISH_CHANGES_ONLY}: true'")
+    return config
+
+
+ROUTE_SCHEMA = automation.validate_automation(
+    {
+        cv.GenerateID(CONF_TRIGGER_ID): cv.declare_id(SesameRouteTrigger),
+        cv.Optional(CONF_EVENT_TYPE): cv.ensure_list(cv.one_of(*EVENT_TYPES, lower=True)),
+        cv.Optional(CONF_HISTORY_TAG): cv.string_strict,
+        cv.Optional(CONF_HISTORY_TAG_TYPE): cv.int_range(0, 255),
+    }
+)
+
+
 TRIGGER_SCHEMA = cv.All(
     event.event_schema().extend(
         {
@@ -143,14 +234,149 @@ TRIGGER_SCHEMA = cv.All(
                 accuracy_decimals=1,
             ),
             cv.Optional(CONF_EXTRA): text_sensor.text_sensor_schema(),
+            cv.Optional(CONF_SWITCH_STATE): binary_sensor.binary_sensor_schema(),
             cv.Optional(CONF_LOCK): cv.use_id(lock.Lock),
             cv.Optional(CONF_CONNECTION_SENSOR): binary_sensor.binary_sensor_schema(
                 device_class=DEVICE_CLASS_CONNECTIVITY,
             ),
+            cv.Optional(CONF_PUBLISH_CHANGES_ONLY, default=False): cv.boolean,
+            cv.Optional(CONF_VOLTAGE_DEADBAND): cv.positive_float,
+            cv.Optional(CONF_BATTERY_PCT_DEADBAND): cv.positive_float,
+            cv.Optional(CONF_DEDUP_WINDOW): cv.All(
+                cv.positive_time_period_milliseconds, cv.Range(max=core.TimePeriod(seconds=60))
+            ),
+            cv.Optional(CONF_ROUTES): ROUTE_SCHEMA,
+            cv.Optional(CONF_CONNECTION_PROFILE, default="none"): cv.enum(CONNECTION_PROFILES),
+            cv.Optional(CONF_AGGREGATE_EVENT, default=False): cv.boolean,
         }
     ),
     validate_address,
     warn_trigger_type_deprecated,
+    validate_deadbands,
+)
+
+
+def latency_sensor_schema():
+    return sensor.sensor_schema(
+        unit_of_measurement=UNIT_MILLISECOND,
+        device_class=DEVICE_CLASS_DURATION,
+        state_class=STATE_CLASS_MEASUREMENT,
+        entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+        accuracy_decimals=1,
+    )
+
+
+def session_sensor_schema():
+    return sensor.sensor_schema(
+        state_class=STATE_CLASS_MEASUREMENT,
+        entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+        accuracy_decimals=0,
+    )
+
+
+def counter_sensor_schema():
+    return sensor.sensor_schema(
+        state_class=STATE_CLASS_TOTAL_INCREASING,
+        entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+        accuracy_decimals=0,
+    )
+
+
+def advertising_interval(value):
+    return cv.All(
+        cv.positive_time_period_milliseconds,
+        cv.Range(min=core.TimePeriod(milliseconds=20), max=core.TimePeriod(milliseconds=10240)),
+    )(value)
+
+
+def event_driven_loop(value):
+    value = cv.boolean(value)
+    if value:
+        # Component::enable_loop_soon_any_context() is available since 2025.7.0
+        cv.require_esphome_version(2025, 7, 0)(value)
+    return value
+
+
+# Dual-core variants with an on-chip BLE controller (ESP32-P4 has none)
+DUAL_CORE_VARIANTS = [VARIANT_ESP32, VARIANT_ESP32S3]
+
+WORKER_TASK_SCHEMA = cv.Schema(
+    {
+        cv.Optional(CONF_CORE, default=1): cv.int_range(0, 1),
+        cv.Optional(CONF_PRIORITY, default=5): cv.int_range(1, 24),
+        cv.Optional(CONF_STACK_SIZE, default=8192): cv.int_range(6144, 16384),
+        cv.Optional(CONF_INTERVAL, default="10ms"): cv.All(
+            cv.positive_time_period_milliseconds,
+            cv.Range(min=core.TimePeriod(milliseconds=1), max=core.TimePeriod(milliseconds=100)),
+        ),
+    }
+)
+
+
+def worker_task(value):
+    # Supported on the same ESPHome versions as event_driven_loop, the two are meant to be combined
+    cv.require_esphome_version(2025, 7, 0)(value)
+    return WORKER_TASK_SCHEMA(value)
+
+
+def validate_worker_task(config: ConfigType) -> ConfigType:
+    if CONF_WORKER_TASK in config and esp32.get_esp32_variant() not in DUAL_CORE_VARIANTS:
+        raise cv.Invalid(f"'{CONF_WORKER_TASK}' requires a dual-core ESP32 ({', '.join(DUAL_CORE_VARIANTS)})")
+    return config
+
+
+ADVERTISING_SCHEMA = cv.Schema(
+    {
+        cv.Optional(CONF_FAST_INTERVAL, default="30ms"): advertising_interval,
+        cv.Optional(CONF_FAST_DURATION, default="30s"): cv.positive_time_period_milliseconds,
+        cv.Optional(CONF_SLOW_INTERVAL, default="320ms"): advertising_interval,
+        cv.Optional(CONF_PAUSE_WHEN_FULL, default=True): cv.boolean,
+    }
+)
+
+
+def validate_backoff(config: ConfigType) -> ConfigType:
+    if config[CONF_INITIAL_BACKOFF] > config[CONF_MAX_BACKOFF]:
+        raise cv.Invalid(f"'{CONF_INITIAL_BACKOFF}' must not be longer than '{CONF_MAX_BACKOFF}'")
+    return config
+
+
+LOCK_STATE_RETRY_SCHEMA = cv.All(
+    cv.Schema(
+        {
+            cv.Optional(CONF_MAX_ATTEMPTS, default=5): cv.int_range(0, 20),
+            cv.Optional(CONF_INITIAL_BACKOFF, default="250ms"): cv.All(
+                cv.positive_time_period_milliseconds, cv.Range(min=core.TimePeriod(milliseconds=50))
+            ),
+            cv.Optional(CONF_MAX_BACKOFF, default="5s"): cv.All(
+                cv.positive_time_period_milliseconds, cv.Range(max=core.TimePeriod(minutes=1))
+            ),
+        }
+    ),
+    validate_backoff,
+)
+
+
+EARLY_START_SCHEMA = cv.Schema(
+    {
+        cv.Optional(CONF_HOLD_TIMEOUT, default="60s"): cv.All(
+            cv.positive_time_period_milliseconds, cv.Range(max=core.TimePeriod(minutes=10))
+        ),
+        cv.Optional(CONF_QUEUE_SIZE, default=32): cv.one_of(8, 16, 32, 64, int=True),
+    }
+)
+
+
+CLIENT_WINDOW_SCHEMA = cv.Schema(
+    {
+        cv.Optional(CONF_IDLE, default="2s"): cv.All(
+            cv.positive_time_period_milliseconds, cv.Range(max=core.TimePeriod(seconds=30))
+        ),
+        cv.Optional(CONF_MAX_WAIT, default="30s"): cv.All(
+            cv.positive_time_period_milliseconds, cv.Range(max=core.TimePeriod(minutes=5))
+        ),
+        cv.Optional(CONF_BLACKOUT): latency_sensor_schema(),
+    }
 )
 
 
@@ -162,6 +388,23 @@ def validate_connect_checks(config):
     return config
 
 
+def validate_unique_triggers(config: ConfigType) -> ConfigType:
+    seen = {}
+    for tconf in config.get(CONF_TRIGGERS, []):
+        name = str(tconf[CONF_ADDRESS]) if CONF_ADDRESS in tconf else str(tconf[CONF_UUID]).lower()
+        key = trigger_key(tconf)
+        if key in seen:
+            raise cv.Invalid(f"Trigger '{name}' has the same address as '{seen[key]}'")
+        seen[key] = name
+    return config
+
+
+def validate_reserved_sessions(config: ConfigType) -> ConfigType:
+    if config[CONF_RESERVED_TRIGGER_SESSIONS] >= config[CONF_MAX_SESSIONS]:
+        raise cv.Invalid(f"'{CONF_RESERVED_TRIGGER_SESSIONS}' must be less than '{CONF_MAX_SESSIONS}'")
+    return config
+
+
 CONFIG_SCHEMA = cv.All(
     cv.Schema(
         {
@@ -184,38 +427,161 @@ CONFIG_SCHEMA = cv.All(
                 validate_connect_checks,
             ),
             cv.Optional(CONF_VERSION_TAG): validate_version_tag,
+            cv.Optional(CONF_LOCK_STATE_COALESCE, default="0ms"): cv.All(
+                cv.positive_time_period_milliseconds, cv.Range(max=core.TimePeriod(seconds=10))
+            ),
+            cv.Optional(CONF_LOCK_STATE_RETRY): LOCK_STATE_RETRY_SCHEMA,
+            cv.Optional(CONF_ADVERTISING): ADVERTISING_SCHEMA,
+            cv.Optional(CONF_EARLY_START): EARLY_START_SCHEMA,
+            cv.Optional(CONF_CLIENT_WINDOW): CLIENT_WINDOW_SCHEMA,
+            cv.Optional(CONF_UNLISTED_CONNECTION_PROFILE, default="none"): cv.enum(CONNECTION_PROFILES),
+            cv.Optional(CONF_UNLISTED_IDLE_TIMEOUT): cv.All(
+                cv.positive_time_period_milliseconds, cv.Range(min=core.TimePeriod(seconds=5))
+            ),
+            cv.Optional(CONF_UNLISTED_EVICTION_IDLE, default="5s"): cv.All(
+                cv.positive_time_period_milliseconds, cv.Range(max=core.TimePeriod(minutes=10))
+            ),
+            cv.Optional(CONF_RESERVED_TRIGGER_SESSIONS, default=0): cv.int_range(0, 8),
+            cv.Optional(CONF_DIAGNOSTICS_INTERVAL, default="60s"): cv.All(
+                cv.positive_time_period_milliseconds, cv.Range(min=core.TimePeriod(seconds=1))
+            ),
+            cv.Optional(CONF_TRIGGER_LATENCY_HISTOGRAM, default=False): cv.boolean,
+            cv.Optional(CONF_EVENT_DRIVEN_LOOP, default=False): event_driven_loop,
+            cv.Optional(CONF_AGGREGATE_SENSOR_INTERVAL, default="60s"): cv.All(
+                cv.positive_time_period_milliseconds, cv.Range(min=core.TimePeriod(seconds=1))
+            ),
+            cv.Optional(CONF_WORKER_TASK): worker_task,
+            cv.Optional(CONF_TRACE_SIZE): cv.int_range(min=8, max=2048),
+            cv.Optional(CONF_EVENT_HISTORY_SIZE): cv.int_range(min=8, max=4096),
+            cv.Optional(CONF_LATENCY_P50): latency_sensor_schema(),
+            cv.Optional(CONF_LATENCY_P99): latency_sensor_schema(),
+            cv.Optional(CONF_LATENCY_MAX): latency_sensor_schema(),
+            **{cv.Optional(key): session_sensor_schema() for key in SESSION_SENSORS},
+            **{cv.Optional(key): counter_sensor_schema() for key in COUNTER_SENSORS},
+            cv.Optional(CONF_LOOP_TIME): sensor.sensor_schema(
+                unit_of_measurement=UNIT_MILLISECOND,
+                state_class=STATE_CLASS_TOTAL_INCREASING,
+                entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+                accuracy_decimals=0,
+            ),
         }
     ).extend(cv.COMPONENT_SCHEMA),
     warn_address_deprecated,
+    validate_unique_triggers,
+    validate_reserved_sessions,
+    validate_worker_task,
 )
 
 
+def final_validate_aggregate_event(config: ConfigType) -> ConfigType:
+    # The values of aggregate_event triggers are carried by a Home Assistant event only, without it they would be lost
+    api_config = fv.full_config.get().get("api")
+    has_services = api_config is not None and api_config.get("homeassistant_services", False)
+    for i, tconf in enumerate(config.get(CONF_TRIGGERS, [])):
+        if tconf[CONF_AGGREGATE_EVENT] and not has_services:
+            raise cv.Invalid(
+                f"'{CONF_AGGREGATE_EVENT}' requires 'homeassistant_services: true' in the 'api' component",
+                path=[CONF_TRIGGERS, i, CONF_AGGREGATE_EVENT],
+            )
+    return config
+
+
+def final_validate_event_history(config: ConfigType) -> ConfigType:
+    # The history is fetched with the sesame_server_get_events action and returned as Home Assistant events
+    if CONF_EVENT_HISTORY_SIZE not in config:
+        return config
+    api_config = fv.full_config.get().get("api")
+    if api_config is None or not (
+        api_config.get("custom_services", False) and api_config.get("homeassistant_services", False)
+    ):
+        raise cv.Invalid(
+            f"'{CONF_EVENT_HISTORY_SIZE}' requires 'custom_services: true' and 'homeassistant_services: true'"
+            " in the 'api' component",
+            path=[CONF_EVENT_HISTORY_SIZE],
+        )
+    return config
+
+
+FINAL_VALIDATE_SCHEMA = cv.All(final_validate_aggregate_event, final_validate_event_history)
+
+
+def fnv1a_hash(value: str) -> int:
+    # Same as fnv1a_hash() in trigger_logic.h
+    result = 2166136261
+    for b in value.encode("utf-8"):
+        result = ((result ^ b) * 16777619) & 0xFFFFFFFF
+    return result
+
+
+async def to_routes_code(trig, config):
+    cg.add_define("USE_SESAME_SERVER_ROUTES")
+    for conf in config:
+        rt = cg.new_Pvariable(conf[CONF_TRIGGER_ID])
+        await automation.build_automation(rt, [(cg.std_string, "event_type")], conf)
+        event_mask = sum(1 << EVENT_TYPES.index(e) for e in set(conf.get(CONF_EVENT_TYPE, EVENT_TYPES)))
+        if CONF_HISTORY_TAG in conf:
+            tag = conf[CONF_HISTORY_TAG]
+            cg.add(trig.add_route(fnv1a_hash(tag), tag, event_mask, conf.get(CONF_HISTORY_TAG_TYPE, -1), rt))
+        else:
+            cg.add(trig.add_route(0, cg.nullptr, event_mask, conf.get(CONF_HISTORY_TAG_TYPE, -1), rt))
+
+
 def mac_to_ints(mac) -> list[int]:
     return [int(x, 16) for x in str(mac).split(":")]
 
 
+def mac_to_key(mac) -> int:
+    """Pack a random BLE address as SesameServerConnectCheckEntry::address"""
+    key = BLE_ADDR_RANDOM_VALUE
+    for b in mac_to_ints(mac):
+        key = (key << 8) | b
+    return key
+
+
+def uuid_to_ints(uuid) -> list[int]:
+    """BLE address derived from a SESAME OS3 UUID, same as SesameServer::uuid_to_ble_address()"""
+    from cryptography.hazmat.primitives.ciphers import algorithms
+    from cryptography.hazmat.primitives.cmac import CMAC
+
+    # The key is the UUID in string order (uuid.bytes is big endian, unlike the native NimBLEUUID),
+    # SesameServerComponent::setup() fails if the library derives another address
+    cmac = CMAC(algorithms.AES(uuid.bytes))
+    cmac.update(b"candy")
+    val = bytearray(cmac.finalize()[:6])  # least significant byte first
+    val[5] |= 0xC0  # static random address
+    return list(reversed(val))
+
+
+def trigger_key(tconf) -> int:
+    """Packed BLE address of a trigger, same layout as mac_to_key()"""
+    key = BLE_ADDR_RANDOM_VALUE
+    for b in mac_to_ints(tconf[CONF_ADDRESS]) if CONF_ADDRESS in tconf else uuid_to_ints(tconf[CONF_UUID]):
+        key = (key << 8) | b
+    return key
+
+
 async def to_connect_checks_code(server, config):
     if len(config) == 0:
         return
-    cg.add_global(cg.RawStatement("#include <NimBLEAddress.h>"), prepend=True)
+    *listed, default = config
+    # First entry wins for duplicated addresses, same as the list order evaluation
+    entries = {}
+    for entry in listed:
+        key = mac_to_key(entry[CONF_ADDRESS])
+        if key in entries:
+            _LOGGER.warning("Duplicated %s address %s ignored", CONF_CONNECT_CHECKS, entry[CONF_ADDRESS])
+            continue
+        entries[key] = entry[CONF_POLICY]
+    if len(entries) == 0:
+        cg.add(server.set_connect_checks(default[CONF_POLICY]))
+        return
     svarid = ID(f"{server.base}_connect_checks", is_declaration=True, type=SesameServerConnectCheckEntry)
-    checks = []
-    zeros = [0] * 6
-    for entry in config:
-        address = zeros if entry[CONF_ADDRESS] == "any" else list(reversed(mac_to_ints(entry[CONF_ADDRESS])))
-        policy = entry[CONF_POLICY]
-        checks.append({"address": address, "policy": policy})
     initializer = [
-        SesameServerConnectCheckEntry(
-            NimBLEAddress()
-            if check["address"] == zeros
-            else NimBLEAddress(cg.StructInitializer(ble_addr_t, ("type", BLE_ADDR_RANDOM), ("val", check["address"]))),
-            check["policy"],
-        )
-        for check in checks
+        cg.StructInitializer(SesameServerConnectCheckEntry, ("address", cg.RawExpression(f"0x{key:x}ULL")), ("policy", policy))
+        for key, policy in sorted(entries.items())
     ]
     svar = cg.static_const_array(svarid, initializer)
-    cg.add(server.set_connect_checks(svar))
+    cg.add(server.set_connect_checks(svar, default[CONF_POLICY]))
 
 
 async def to_code(config):
@@ -227,13 +593,82 @@ async def to_code(config):
         cg.add(var.set_lock_entity(lock))
     if CONF_VERSION_TAG in config:
         cg.add(var.set_version_tag(config[CONF_VERSION_TAG]))
+    if config[CONF_LOCK_STATE_COALESCE].total_milliseconds > 0:
+        cg.add(var.set_lock_state_coalesce(config[CONF_LOCK_STATE_COALESCE].total_milliseconds))
+    if CONF_LOCK_STATE_RETRY in config:
+        retry = config[CONF_LOCK_STATE_RETRY]
+        cg.add(
+            var.set_lock_state_retry(
+                retry[CONF_MAX_ATTEMPTS],
+                retry[CONF_INITIAL_BACKOFF].total_milliseconds,
+                retry[CONF_MAX_BACKOFF].total_milliseconds,
+            )
+        )
+    if CONF_ADVERTISING in config:
+        adv = config[CONF_ADVERTISING]
+        cg.add(
+            var.set_advertising_profile(
+                adv[CONF_FAST_INTERVAL].total_milliseconds,
+                adv[CONF_FAST_DURATION].total_milliseconds,
+                adv[CONF_SLOW_INTERVAL].total_milliseconds,
+                adv[CONF_PAUSE_WHEN_FULL],
+            )
+        )
+    if CONF_EARLY_START in config:
+        early = config[CONF_EARLY_START]
+        cg.add_define("SESAME_SERVER_COMMAND_QUEUE_SIZE", early[CONF_QUEUE_SIZE])
+        cg.add(var.set_early_start(early[CONF_HOLD_TIMEOUT].total_milliseconds))
+    if CONF_CLIENT_WINDOW in config:
+        window = config[CONF_CLIENT_WINDOW]
+        cg.add(var.set_client_window_timing(window[CONF_IDLE].total_milliseconds, window[CONF_MAX_WAIT].total_milliseconds))
+        if CONF_BLACKOUT in window:
+            sens = await sensor.new_sensor(window[CONF_BLACKOUT])
+            cg.add(var.set_client_window_blackout_sensor(sens))
+    if CONF_UNLISTED_IDLE_TIMEOUT in config:
+        cg.add(var.set_unlisted_idle_timeout(config[CONF_UNLISTED_IDLE_TIMEOUT].total_milliseconds))
+    cg.add(var.set_unlisted_eviction_idle(config[CONF_UNLISTED_EVICTION_IDLE].total_milliseconds))
+    if config[CONF_UNLISTED_CONNECTION_PROFILE] != "none":
+        cg.add(var.set_unlisted_connection_profile(config[CONF_UNLISTED_CONNECTION_PROFILE]))
+    if config[CONF_RESERVED_TRIGGER_SESSIONS] > 0:
+        cg.add(var.set_reserved_trigger_sessions(config[CONF_RESERVED_TRIGGER_SESSIONS]))
+    cg.add(var.set_diagnostics_interval(config[CONF_DIAGNOSTICS_INTERVAL].total_milliseconds))
+    if config[CONF_TRIGGER_LATENCY_HISTOGRAM]:
+        cg.add_define("USE_SESAME_SERVER_TRIGGER_LATENCY")
+    if config[CONF_EVENT_DRIVEN_LOOP]:
+        cg.add_define("USE_SESAME_SERVER_EVENT_DRIVEN_LOOP")
+        cg.add(var.set_event_driven_loop(True))
+    if CONF_WORKER_TASK in config:
+        worker = config[CONF_WORKER_TASK]
+        cg.add_define("USE_SESAME_SERVER_WORKER_TASK")
+        cg.add(
+            var.set_worker_task(
+                worker[CONF_CORE],
+                worker[CONF_PRIORITY],
+                worker[CONF_STACK_SIZE],
+                worker[CONF_INTERVAL].total_milliseconds,
+            )
+        )
+    if CONF_EVENT_HISTORY_SIZE in config:
+        cg.add_define("USE_SESAME_SERVER_EVENT_HISTORY")
+        cg.add(var.set_event_history_size(config[CONF_EVENT_HISTORY_SIZE]))
+    if CONF_TRACE_SIZE in config:
+        cg.add_define("USE_SESAME_SERVER_TRACE")
+        cg.add(var.set_trace_size(config[CONF_TRACE_SIZE]))
+    if any(tconf[CONF_AGGREGATE_EVENT] for tconf in config.get(CONF_TRIGGERS, [])):
+        cg.add_define("USE_SESAME_SERVER_AGGREGATE_EVENT")
+        cg.add(var.set_aggregate_sensor_interval(config[CONF_AGGREGATE_SENSOR_INTERVAL].total_milliseconds))
+    if any(key in config for key in LATENCY_SENSORS):
+        cg.add_define("USE_SESAME_SERVER_LATENCY_SENSORS")
+    for key in LATENCY_SENSORS + SESSION_SENSORS + COUNTER_SENSORS + [CONF_LOOP_TIME]:
+        if key in config:
+            s = await sensor.new_sensor(config[key])
+            cg.add(getattr(var, f"set_{key}_sensor")(s))
     await cg.register_component(var, config)
     if CONF_TRIGGERS in config:
         triggers = []
-        for tconf in config[CONF_TRIGGERS]:
-            address = tconf.get(CONF_ADDRESS) or ""
-            uuid = tconf.get(CONF_UUID) or ""
-            trig = cg.new_Pvariable(tconf[CONF_ID], var, str(address), str(uuid))
+        # Added in address order, SesameServerComponent searches the triggers list as is
+        for tconf in sorted(config[CONF_TRIGGERS], key=trigger_key):
+            trig = cg.new_Pvariable(tconf[CONF_ID], var, cg.RawExpression(f"0x{trigger_key(tconf):x}ULL"))
             triggers.append((trig, tconf))
             if CONF_HISTORY_TAG in tconf:
                 t = await text_sensor.new_text_sensor(tconf[CONF_HISTORY_TAG])
@@ -256,6 +691,9 @@ async def to_code(config):
             if CONF_EXTRA in tconf:
                 s = await text_sensor.new_text_sensor(tconf[CONF_EXTRA])
                 cg.add(trig.set_extra_sensor(s))
+            if CONF_SWITCH_STATE in tconf:
+                bs = await binary_sensor.new_binary_sensor(tconf[CONF_SWITCH_STATE])
+                cg.add(trig.set_switch_state_sensor(bs))
             if CONF_LOCK in tconf:
                 lock = await cg.get_variable(tconf[CONF_LOCK])
                 cg.add(trig.set_lock_entity(lock))
@@ -263,7 +701,25 @@ async def to_code(config):
                 bconf = tconf[CONF_CONNECTION_SENSOR]
                 bs = await binary_sensor.new_binary_sensor(bconf)
                 cg.add(trig.set_connection_sensor(bs))
+            if CONF_DEDUP_WINDOW in tconf:
+                cg.add_define("USE_SESAME_SERVER_DEDUP")
+                cg.add(trig.set_dedup_window(tconf[CONF_DEDUP_WINDOW].total_milliseconds))
+            if CONF_ROUTES in tconf:
+                await to_routes_code(trig, tconf[CONF_ROUTES])
+            if tconf[CONF_CONNECTION_PROFILE] != "none":
+                cg.add(trig.set_connection_profile(tconf[CONF_CONNECTION_PROFILE]))
+            if tconf[CONF_AGGREGATE_EVENT]:
+                cg.add(trig.set_aggregate_event(True))
+            if tconf[CONF_PUBLISH_CHANGES_ONLY]:
+                cg.add_define("USE_SESAME_SERVER_PUBLISH_CHANGES_ONLY")
+                cg.add(trig.set_publish_changes_only(True))
+                if CONF_VOLTAGE_DEADBAND in tconf:
+                    cg.add(trig.set_voltage_deadband(tconf[CONF_VOLTAGE_DEADBAND]))
+                if CONF_BATTERY_PCT_DEADBAND in tconf:
+                    cg.add(trig.set_battery_pct_deadband(tconf[CONF_BATTERY_PCT_DEADBAND]))
             cg.add(var.add_trigger(trig))
+            if CONF_UUID in tconf:
+                cg.add(var.add_uuid_check(cg.RawExpression(f"0x{trigger_key(tconf):x}ULL"), str(tconf[CONF_UUID])))
         for trig, tconf in triggers:
             await event.register_event(trig, tconf, event_types=EVENT_TYPES)
 
@@ -0,0 +1,27 @@
+#pragma once
+#include <esphome/core/defines.h>
+
+#if defined(USE_SESAME_SERVER_EVENT_HISTORY) && defined(USE_API_SERVICES) && defined(USE_API_HOMEASSISTANT_SERVICES)
+#define SESAME_SERVER_EVENT_HISTORY_SERVICE 1
+#include <esphome/components/api/custom_api_device.h>
+#include <cstdint>
+
+namespace esphome::sesame_server {
+
+class SesameServerComponent;
+
+// API service `sesame_server_get_events(since)`, replaying the event history entries newer than `since`
+// as `esphome.sesame_server_event` Home Assistant events.
+class EventHistoryService : public api::CustomAPIDevice {
+ public:
+	explicit EventHistoryService(SesameServerComponent& server) : server(server) {}
+	void start() { register_service(&EventHistoryService::on_get_events, "sesame_server_get_events", {"since"}); }
+
+ private:
+	void on_get_events(int32_t since);
+
+	SesameServerComponent& server;
+};
+
+}  // namespace esphome::sesame_server
+#endif
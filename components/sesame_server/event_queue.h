@@ -0,0 +1,44 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace esphome::sesame_server {
+
+// Fixed capacity ring buffer handing records from one producer task to one consumer task without allocation.
+// The producer fills the slot returned by prepare() in place and publishes it with commit().
+// The consumer reads front() in place and releases it with pop().
+template <typename T, size_t N>
+class EventQueue {
+	static_assert(N > 0 && (N & (N - 1)) == 0, "EventQueue capacity must be a power of 2");
+
+ public:
+	T* prepare() {
+		auto h = head.load(std::memory_order_relaxed);
+		if (h - tail.load(std::memory_order_acquire) >= N) {
+			return nullptr;
+		}
+		return &slots[h % N];
+	}
+	void commit() { head.store(head.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+	T* front() {
+		auto t = tail.load(std::memory_order_relaxed);
+		if (t == head.load(std::memory_order_acquire)) {
+			return nullptr;
+		}
+		return &slots[t % N];
+	}
+	void pop() { tail.store(tail.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+	bool empty() const { return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire); }
+	// Records committed and not popped yet, more may be committed meanwhile
+	size_t size() const { return head.load(std::memory_order_acquire) - tail.load(std::memory_order_relaxed); }
+	static constexpr size_t capacity() { return N; }
+
+ private:
+	std::array<T, N> slots{};
+	std::atomic<uint32_t> head{0};
+	std::atomic<uint32_t> tail{0};
+};
+
+}  // namespace esphome::sesame_server
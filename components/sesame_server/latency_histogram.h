@@ -0,0 +1,70 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace esphome::sesame_server {
+
+// Fixed bucket latency histogram in microseconds.
+// Bucket 0 covers [0, 256us), each following bucket doubles the upper bound, the last one collects everything above.
+class LatencyHistogram {
+ public:
+	static constexpr size_t BUCKETS = 16;
+	static constexpr unsigned FIRST_BUCKET_SHIFT = 8;
+
+	void record(uint32_t us) {
+		counts[bucket_of(us)]++;
+		count++;
+		if (us > max_us) {
+			max_us = us;
+		}
+	}
+	void merge(const LatencyHistogram& other) {
+		for (size_t i = 0; i < BUCKETS; i++) {
+			counts[i] += other.counts[i];
+		}
+		count += other.count;
+		if (other.max_us > max_us) {
+			max_us = other.max_us;
+		}
+	}
+	void reset() { *this = LatencyHistogram{}; }
+	// Upper bound of the bucket containing the p-th percentile (0 < p <= 1), capped at the maximum seen.
+	uint32_t percentile(float p) const {
+		if (count == 0) {
+			return 0;
+		}
+		uint32_t rank = static_cast<uint32_t>(p * count + 0.999f);
+		if (rank == 0) {
+			rank = 1;
+		}
+		uint32_t cumulative = 0;
+		for (size_t i = 0; i < BUCKETS - 1; i++) {
+			cumulative += counts[i];
+			if (cumulative >= rank) {
+				uint32_t upper = 1u << (FIRST_BUCKET_SHIFT + i);
+				return upper < max_us ? upper : max_us;
+			}
+		}
+		return max_us;
+	}
+	uint32_t get_max() const { return max_us; }
+	uint32_t get_count() const { return count; }
+	uint32_t get_bucket_count(size_t bucket) const { return bucket < BUCKETS ? counts[bucket] : 0; }
+
+	static size_t bucket_of(uint32_t us) {
+		us >>= FIRST_BUCKET_SHIFT;
+		if (us == 0) {
+			return 0;
+		}
+		size_t bucket = 32 - __builtin_clz(us);
+		return bucket < BUCKETS ? bucket : BUCKETS - 1;
+	}
+
+ private:
+	std::array<uint32_t, BUCKETS> counts{};
+	uint32_t count = 0;
+	uint32_t max_us = 0;
+};
+
+}  // namespace esphome::sesame_server
@@ -2,9 +2,13 @@
 #include <esphome/core/application.h>
 #include <esphome/core/log.h>
 #include <esphome/core/version.h>
+#ifdef USE_API
+#include <esphome/components/api/api_server.h>
+#endif
 #include <libsesame3bt/ClientCore.h>
 #include <libsesame3bt/util.h>
 #include <algorithm>
+#include <cinttypes>
 #include <cmath>
 #include <optional>
 
@@ -23,6 +27,33 @@ constexpr const uint32_t SESAMESERVER_RANDOM = 0x76d18970;
 constexpr int16_t LOCK_POSITION = 0;
 constexpr int16_t UNLOCK_POSITION = 90;
 
+#ifdef USE_SESAME_SERVER_EVENT_DRIVEN_LOOP
+constexpr uint32_t HANDSHAKE_TIMEOUT_MS = 30 * 1000;
+#endif
+
+struct connection_params_t {
+	uint16_t min_interval;  // 1.25ms units
+	uint16_t max_interval;  // 1.25ms units
+	uint16_t latency;       // connection events the peer may skip
+	uint16_t timeout;       // 10ms units
+};
+
+// Indexed by connection_profile_t. The supervision timeout stays above (1 + latency) * max_interval * 2.
+constexpr std::array<connection_params_t, CONNECTION_PROFILE_COUNT> CONNECTION_PROFILES{{
+    {0, 0, 0, 0},         // none
+    {6, 12, 0, 200},      // low_latency: 7.5-15ms, 2s
+    {24, 40, 0, 400},     // balanced: 30-50ms, 4s
+    {80, 160, 4, 600},    // low_power: 100-200ms, skip up to 4 events, 6s
+}};
+
+#ifdef USE_SESAME_SERVER_WORKER_TASK
+using ServerLock = LockGuard;
+#else
+struct ServerLock {
+	explicit ServerLock(server_mutex_t&) {}
+};
+#endif
+
 }  // namespace
 
 using libsesame3bt::Sesame;
@@ -31,6 +62,28 @@ using history_tag_type_t = libsesame3bt::history_tag_type_t;
 using Status = libsesame3bt::core::Status;
 namespace util = libsesame3bt::core::util;
 
+static uint64_t
+address_key(const NimBLEAddress& addr) {
+	// Pack the 48 bit address and its type into a single integer, as codegen does for triggers and connect_checks,
+	// so that the tables can be kept sorted and searched without NimBLEAddress comparisons.
+	const uint8_t* val = addr.getVal();
+	uint64_t key = addr.getType();
+	for (int i = 5; i >= 0; i--) {
+		key = (key << 8) | val[i];
+	}
+	return key;
+}
+
+static NimBLEAddress
+key_to_address(uint64_t key) {
+	ble_addr_t addr{};
+	for (int i = 0; i < 6; i++) {
+		addr.val[i] = static_cast<uint8_t>(key >> (i * 8));
+	}
+	addr.type = static_cast<uint8_t>(key >> 48);
+	return addr;
+}
+
 static const char*
 event_name(Sesame::item_code_t cmd) {
 	using item_code_t = Sesame::item_code_t;
@@ -49,8 +102,69 @@ event_name(Sesame::item_code_t cmd) {
 	}
 }
 
+static float
+make_float(std::optional<history_tag_type_t> history_tag_type) {
+	if (history_tag_type.has_value()) {
+		return static_cast<float>(*history_tag_type);
+	}
+	return NAN;
+}
+
+static const char*
+connection_profile_name(connection_profile_t profile) {
+	switch (profile) {
+		case connection_profile_t::low_latency:
+			return "low_latency";
+		case connection_profile_t::balanced:
+			return "balanced";
+		case connection_profile_t::low_power:
+			return "low_power";
+		default:
+			return "none";
+	}
+}
+
+static disconnect_reason_t
+classify_disconnect_reason(int reason) {
+	// NimBLE reports HCI error codes offset by BLE_HS_ERR_HCI_BASE (0x200)
+	switch (reason & 0xff) {
+		case 0x13:  // Remote User Terminated Connection
+		case 0x14:  // Remote Device Terminated due to Low Resources
+		case 0x15:  // Remote Device Terminated due to Power Off
+			return disconnect_reason_t::remote_terminated;
+		case 0x16:  // Connection Terminated By Local Host
+			return disconnect_reason_t::local_terminated;
+		case 0x08:  // Connection Timeout
+		case 0x22:  // LL Response Timeout
+			return disconnect_reason_t::timeout;
+		case 0x3e:  // Connection Failed to be Established
+			return disconnect_reason_t::failed_to_establish;
+		default:
+			return disconnect_reason_t::other;
+	}
+}
+
 SesameServerComponent::SesameServerComponent(uint8_t max_sessions, std::string_view uuid)
-    : sesame_server(max_sessions), uuid(std::string{uuid}) {}
+    : sesame_server(max_sessions), uuid(std::string{uuid}) {
+	session_stats.max_sessions = max_sessions;
+}
+
+bool
+SesameServerComponent::check_uuid_addresses() {
+	// Codegen reimplements the address derivation of the library, a mismatch would leave the trigger deaf
+	bool ok = true;
+	for (const auto& check : uuid_checks) {
+		auto addr = SesameServer::uuid_to_ble_address(NimBLEUUID{std::string{check.uuid}});
+		if (address_key(addr) != check.key) {
+			ESP_LOGE(TAG, "uuid %s: configured as %s, but the library derives %s", check.uuid,
+			         key_to_address(check.key).toString().c_str(), addr.toString().c_str());
+			ok = false;
+		}
+	}
+	uuid_checks.clear();
+	uuid_checks.shrink_to_fit();
+	return ok;
+}
 
 bool
 SesameServerComponent::prepare_secret() {
@@ -76,32 +190,112 @@ SesameServerComponent::save_secret(const std::array<std::byte, Sesame::SECRET_SI
 	return false;
 }
 
+Sesame::result_code_t
+SesameServerComponent::enqueue_command(const NimBLEAddress& addr,
+                                       Sesame::item_code_t cmd,
+                                       std::string_view tag,
+                                       std::optional<history_tag_type_t> history_tag_type,
+                                       float scaled_voltage,
+                                       float scaled_voltage2,
+                                       std::string_view extra) {
+	// Runs on the NimBLE host task whether or not the worker task pumps sesame_server, so no lock is needed
+	auto* ev = command_queue.prepare();
+	if (!ev) {
+		command_overflow_count.fetch_add(1, std::memory_order_relaxed);
+		ESP_LOGW(TAG, "%s: Command queue full, cmd=%s(%u) dropped", addr.toString().c_str(), event_name(cmd),
+		         static_cast<uint8_t>(cmd));
+		return Sesame::result_code_t::success;
+	}
+	if (tag.size() > std::size(ev->tag)) {
+		ESP_LOGW(TAG, "%s: history tag truncated (%u bytes)", addr.toString().c_str(), static_cast<unsigned>(tag.size()));
+		tag = tag.substr(0, std::size(ev->tag));
+	}
+	if (extra.size() > std::size(ev->extra)) {
+		ESP_LOGW(TAG, "%s: extra data truncated (%u bytes)", addr.toString().c_str(), static_cast<unsigned>(extra.size()));
+		extra = extra.substr(0, std::size(ev->extra));
+	}
+	ev->address = addr;
+	ev->item_code = cmd;
+	ev->history_tag_type = history_tag_type;
+	ev->scaled_voltage = scaled_voltage;
+	ev->scaled_voltage2 = scaled_voltage2;
+	ev->received_us = micros();
+	ev->tag_len = tag.size();
+	std::copy(std::cbegin(tag), std::cend(tag), ev->tag);
+	ev->extra_len = extra.size();
+	std::transform(std::cbegin(extra), std::cend(extra), ev->extra, [](char c) { return static_cast<std::byte>(c); });
+	command_queue.commit();
+	wake_loop();
+	return Sesame::result_code_t::success;
+}
+
 void
-SesameServerComponent::on_command(const NimBLEAddress& addr,
-                                  Sesame::item_code_t cmd,
-                                  const std::string tag,
-                                  std::optional<history_tag_type_t> history_tag_type,
-                                  float scaled_voltage,
-                                  float scaled_voltage2,
-                                  std::string_view extra) {
-	ESP_LOGD(TAG, "cmd=%s(%u), tag=\"%s\", type=%.0f from=%s", event_name(cmd), static_cast<uint8_t>(cmd), tag.c_str(),
-	         history_tag_type.has_value() ? static_cast<float>(*history_tag_type) : NAN, addr.toString().c_str());
-	if (auto trig = std::find_if(std::cbegin(triggers), std::cend(triggers),
-	                             [&addr](const auto& trigger) { return trigger->get_address() == addr; });
-	    trig == std::cend(triggers)) {
-		ESP_LOGW(TAG, "%s: cmd=%s(%u), tag=\"%s\" received from unlisted device", addr.toString().c_str(), event_name(cmd),
-		         static_cast<uint8_t>(cmd), tag.c_str());
+SesameServerComponent::on_command(const command_event_t& ev) {
+	auto dequeued_us = micros();
+	last_command_ms = millis() - (dequeued_us - ev.received_us) / 1000;
+	const auto& addr = ev.address;
+	auto cmd = ev.item_code;
+	auto tag = ev.get_tag();
+	ESP_LOGD(TAG, "cmd=%s(%u), tag=\"%.*s\", type=%.0f from=%s", event_name(cmd), static_cast<uint8_t>(cmd),
+	         static_cast<int>(tag.size()), tag.data(), make_float(ev.history_tag_type), addr.toString().c_str());
+#ifdef USE_SESAME_SERVER_TRACE
+	if (auto* rec = trace(trace_event_t::command, addr)) {
+		rec->time_us = ev.received_us;
+		rec->code = static_cast<uint8_t>(cmd);
+		rec->history_tag_type = ev.history_tag_type ? static_cast<uint8_t>(*ev.history_tag_type) : 0xff;
+		rec->tag_len = tag.size();
+		std::copy(std::cbegin(tag), std::cend(tag), std::begin(rec->tag));
+		rec->scaled_voltage = ev.scaled_voltage;
+		rec->scaled_voltage2 = ev.scaled_voltage2;
+		rec->extra_len = ev.extra_len;
+		std::copy(ev.extra, ev.extra + ev.extra_len, std::begin(rec->extra));
+	}
+#endif
+	if (auto trig = find_trigger(addr); trig == nullptr) {
+		ESP_LOGW(TAG, "%s: cmd=%s(%u), tag=\"%.*s\" received from unlisted device", addr.toString().c_str(), event_name(cmd),
+		         static_cast<uint8_t>(cmd), static_cast<int>(tag.size()), tag.data());
+		if (auto* session = find_unlisted_session(addr)) {
+			session->last_activity = millis();
+		}
 	} else {
-		(*trig)->invoke(cmd, tag, history_tag_type, scaled_voltage, scaled_voltage2, extra);
+		if (trig->invoke(cmd, tag, ev.history_tag_type, ev.scaled_voltage, ev.scaled_voltage2, ev.get_extra(), ev.received_us,
+		                 dequeued_us)) {
+#ifdef USE_SESAME_SERVER_EVENT_HISTORY
+			record_event(*trig, ev);
+#endif
+		}
 	}
 }
 
 void
 SesameServerComponent::setup() {
+	if (unsorted_triggers) {
+		ESP_LOGE(TAG, "Triggers with duplicated or unsorted addresses configured");
+		mark_failed();
+		return;
+	}
+	if (!check_uuid_addresses()) {
+		mark_failed();
+		return;
+	}
 	if (!prepare_secret()) {
 		mark_failed();
 		return;
 	}
+#ifdef USE_SESAME_SERVER_TRACE
+	trace_buffer.allocate(trace_size);
+#endif
+	if (early_start && event_hold_timeout_ms > 0) {
+		holding_events = true;
+		set_timeout("event_hold", event_hold_timeout_ms, [this]() { release_events("timeout"); });
+	}
+#ifdef USE_SESAME_SERVER_EVENT_HISTORY
+	event_history.allocate(event_history_size);
+#ifdef SESAME_SERVER_EVENT_HISTORY_SERVICE
+	event_history_service = std::make_unique<EventHistoryService>(*this);
+	event_history_service->start();
+#endif
+#endif
 	if (!sesame_server.is_registered()) {
 		sesame_server.set_on_registration_callback([this](const auto& addr, const auto& secret) {
 			this->save_secret(secret);
@@ -114,17 +308,12 @@ SesameServerComponent::setup() {
 	}
 	sesame_server.set_on_command_callback([this](const auto& addr, auto item_code, const auto& tag, auto history_tag_type,
 	                                             auto scaled_voltage, auto scaled_voltage2, auto extra) {
-		defer([this, addr, item_code, tag_str = tag, history_tag_type, scaled_voltage, scaled_voltage2, extra]() {
-			on_command(addr, item_code, tag_str, history_tag_type, scaled_voltage, scaled_voltage2, extra);
-		});
-		return Sesame::result_code_t::success;
+		return enqueue_command(addr, item_code, tag, history_tag_type, scaled_voltage, scaled_voltage2, extra);
 	});
 	sesame_server.set_on_connect_callback([this](const auto& addr) { defer([this, addr]() { on_connected(addr); }); });
 	sesame_server.set_on_disconnect_callback(
 	    [this](const auto& addr, int reason) { defer([this, addr, reason]() { on_disconnect(addr, reason); }); });
-	if (!connect_checks.empty()) {
-		sesame_server.set_connect_check_callback([this](const auto& addr) { return connect_check(addr); });
-	}
+	sesame_server.set_connect_check_callback([this](const auto& addr) { return connect_check(addr); });
 
 	Sesame::mecha_setting_5_t setting{};
 	setting.lock_position = LOCK_POSITION;
@@ -136,37 +325,374 @@ SesameServerComponent::setup() {
 	ESP_LOGD(TAG, "mechaSetting: lock=%d unlock=%d auto_lock=%d", setting.lock_position, setting.unlock_position,
 	         setting.auto_lock_sec);
 
-	if (!sesame_server.begin(Sesame::model_t::sesame_5, uuid) || !sesame_server.start_advertising()) {
+	if (!sesame_server.begin(Sesame::model_t::sesame_5, uuid) ||
+	    (advertising_scheduler && !apply_advertising_interval(fast_advertising_interval_ms)) || !sesame_server.start_advertising()) {
 		ESP_LOGE(TAG, "Failed to start SESAME server");
 		mark_failed();
 		return;
 	}
 	server_started = true;
+#ifdef USE_SESAME_SERVER_WORKER_TASK
+	if (!start_worker_task()) {
+		ESP_LOGE(TAG, "Failed to start worker task");
+		mark_failed();
+		return;
+	}
+#endif
+	if (advertising_scheduler) {
+		start_fast_advertising();
+	}
+	if (unlisted_idle_timeout_ms > 0) {
+		set_interval("unlisted_idle", std::clamp<uint32_t>(unlisted_idle_timeout_ms / 4, 1000, 60 * 1000),
+		             [this]() { evict_unlisted_sessions(false); });
+	}
+#ifdef SESAME_SERVER_AGGREGATE_EVENT_API
+	if (std::any_of(std::cbegin(triggers), std::cend(triggers), [](const auto& trig) { return trig->is_aggregate_event(); })) {
+		aggregate_event_api = std::make_unique<api::CustomAPIDevice>();
+		set_interval("aggregate_sensors", aggregate_sensor_interval_ms, [this]() {
+			for (auto& trig : triggers) {
+				if (trig->is_aggregate_event()) {
+					trig->flush_sensors();
+				}
+			}
+		});
+	}
+#endif
+	if (has_diagnostic_sensors()) {
+		set_interval("diagnostics", diagnostics_interval_ms, [this]() { publish_diagnostics(); });
+	}
 	ESP_LOGI(TAG, "SESAME Server started as %sregistered on %s", sesame_server.is_registered() ? "" : "not ",
 	         NimBLEDevice::getAddress().toString().c_str());
 }
 
 bool
-SesameServerComponent::connect_check(const NimBLEAddress& addr) {
-	if (connect_checks.empty()) {
+SesameServerComponent::check_connect_policy(const NimBLEAddress& addr) {
+	if (!connect_check_default.has_value()) {
 		return true;
 	}
-	auto it = std::find_if(std::cbegin(connect_checks), std::cend(connect_checks),
-	                       [&addr](const auto& entry) { return entry.address.isNull() || entry.address == addr; });
-	if (it == std::cend(connect_checks)) {
+	auto key = address_key(addr);
+	auto policy = *connect_check_default;
+	bool listed = false;
+	if (!connect_checks.empty()) {
+		// Branch-free binary search: the table is sorted and deduplicated by codegen.
+		const auto* base = connect_checks.data();
+		for (size_t n = connect_checks.size(); n > 1; n -= n / 2) {
+			base = base[n / 2].address <= key ? base + n / 2 : base;
+		}
+		if (base->address == key) {
+			policy = base->policy;
+			listed = true;
+		}
+	}
+	if (policy == connect_check_policy_t::allow) {
+		return true;
+	}
+	if (listed) {
+		ESP_LOGI(TAG, "%s: Connection denied by connect_check", addr.toString().c_str());
+	} else {
 		ESP_LOGW(TAG, "%s: Connection denied: not in connect_check", addr.toString().c_str());
+	}
+	return false;
+}
+
+bool
+SesameServerComponent::check_admission(const NimBLEAddress& addr) {
+	auto sessions = active_sessions.load(std::memory_order_relaxed);
+	if (has_trigger(addr)) {
+		// Configured triggers outrank unlisted peers: make room for the next attempt if all slots are taken.
+		if (sessions >= session_stats.max_sessions && unlisted_session_count.load(std::memory_order_relaxed) > 0) {
+			ESP_LOGI(TAG, "%s: Sessions full, evicting an unlisted session", addr.toString().c_str());
+			eviction_requested.store(true, std::memory_order_relaxed);
+			wake_loop();
+		}
+		return true;
+	}
+	if (reserved_trigger_sessions > 0 && sessions + reserved_trigger_sessions >= session_stats.max_sessions) {
+		ESP_LOGI(TAG, "%s: Connection denied: remaining sessions are reserved for triggers", addr.toString().c_str());
 		return false;
 	}
-	auto rc = it->policy == connect_check_policy_t::allow;
-	if (!rc) {
-		ESP_LOGI(TAG, "%s: Connection denied by connect_check", addr.toString().c_str());
+	return true;
+}
+
+bool
+SesameServerComponent::connect_check(const NimBLEAddress& addr) {
+	if (auto blocked = client_window_blocked.load(std::memory_order_relaxed); blocked != 0 && blocked == address_key(addr)) {
+		ESP_LOGD(TAG, "%s: Connection denied during client window", addr.toString().c_str());
+		connect_denied_count.fetch_add(1, std::memory_order_relaxed);
+		return false;
+	}
+	if (check_connect_policy(addr) && check_admission(addr)) {
+		connect_allowed_count.fetch_add(1, std::memory_order_relaxed);
+		wake_loop();
+		return true;
+	}
+	connect_denied_count.fetch_add(1, std::memory_order_relaxed);
+	return false;
+}
+
+void
+SesameServerComponent::evict_unlisted_sessions(bool lru) {
+	auto now = millis();
+	auto lru_session = std::cend(unlisted_sessions);
+	for (auto it = std::cbegin(unlisted_sessions); it != std::cend(unlisted_sessions); ++it) {
+		if (unlisted_idle_timeout_ms > 0 && now - it->last_activity >= unlisted_idle_timeout_ms) {
+			ESP_LOGI(TAG, "%s (unlisted) idle for %" PRIu32 "ms, disconnecting", it->address.toString().c_str(),
+			         now - it->last_activity);
+			disconnect(it->address);
+		} else if (now - it->last_activity >= unlisted_eviction_idle_ms &&
+		           (lru_session == std::cend(unlisted_sessions) || now - it->last_activity > now - lru_session->last_activity)) {
+			lru_session = it;
+		}
+	}
+	if (!lru) {
+		return;
+	}
+	if (lru_session != std::cend(unlisted_sessions)) {
+		ESP_LOGI(TAG, "%s (unlisted) least recently used, disconnecting", lru_session->address.toString().c_str());
+		disconnect(lru_session->address);
+	} else {
+		ESP_LOGD(TAG, "No idle unlisted session to evict");
 	}
-	return rc;
+}
+
+void
+SesameServerComponent::dump_config() {
+	ESP_LOGCONFIG(TAG, "SESAME Server:");
+	size_t sensor_groups = 0;
+	for (const auto& trig : triggers) {
+		if (trig->has_sensors()) {
+			sensor_groups++;
+		}
+	}
+	ESP_LOGCONFIG(TAG, "  Triggers: %u (%u bytes each, %u with sensor group of %u bytes)",
+	              static_cast<unsigned>(triggers.size()), static_cast<unsigned>(sizeof(SesameTrigger)),
+	              static_cast<unsigned>(sensor_groups), static_cast<unsigned>(sizeof(trigger_sensors_t)));
+	for (const auto& trig : triggers) {
+		if (trig->get_connection_profile() != connection_profile_t::none) {
+			ESP_LOGCONFIG(TAG, "  Connection profile of %s: %s", trig->get_name().c_str(),
+			              connection_profile_name(trig->get_connection_profile()));
+		}
+	}
+	ESP_LOGCONFIG(TAG, "  Connection profile of unlisted devices: %s", connection_profile_name(unlisted_connection_profile));
+#if defined(USE_SESAME_SERVER_AGGREGATE_EVENT) && !defined(SESAME_SERVER_AGGREGATE_EVENT_API)
+	ESP_LOGW(TAG, "  aggregate_event requires Home Assistant services of the API component, sensors are published directly");
+#endif
 }
 
 void
 SesameServerComponent::loop() {
+	auto start_us = micros();
+#ifdef USE_SESAME_SERVER_EVENT_DRIVEN_LOOP
+	if (!loop_enabled) {
+		loop_enabled = true;
+		loop_stats.wakeups++;
+	}
+#endif
+#ifndef USE_SESAME_SERVER_WORKER_TASK
 	sesame_server.update();
+#endif
+	if (eviction_requested.exchange(false, std::memory_order_relaxed)) {
+		evict_unlisted_sessions(true);
+	}
+	bool holding = false;
+	if (holding_events) {
+#ifdef USE_API
+		holding = api::global_api_server == nullptr || !api::global_api_server->is_connected();
+#endif
+		if (!holding) {
+			release_events("API connected");
+		}
+	}
+	if (!holding) {
+		while (auto* ev = command_queue.front()) {
+			on_command(*ev);
+			command_queue.pop();
+			if (held_commands > 0) {
+				held_commands--;
+			}
+		}
+	}
+#ifdef USE_SESAME_SERVER_EVENT_DRIVEN_LOOP
+	if (event_driven_loop) {
+		update_loop_state();
+	}
+#endif
+	auto elapsed_us = micros() - start_us;
+	loop_stats.iterations++;
+	loop_stats.busy_us += elapsed_us;
+	loop_stats.max_us = std::max(loop_stats.max_us, elapsed_us);
+}
+
+#ifdef USE_SESAME_SERVER_EVENT_DRIVEN_LOOP
+void
+SesameServerComponent::update_loop_state() {
+	auto now = millis();
+	if (auto allowed = get_connect_allowed_count(); allowed != seen_connect_allowed_count) {
+		seen_connect_allowed_count = allowed;
+		handshake_pending = true;
+		handshake_start_ms = now;
+	}
+	// Give up on a handshake that neither completed nor disconnected, registration by the app included
+	if (handshake_pending && now - handshake_start_ms >= HANDSHAKE_TIMEOUT_MS) {
+		handshake_pending = false;
+	}
+	// Run the loop without delay only during transactions
+	if (handshake_pending || !command_queue.empty()) {
+		high_frequency_loop.start();
+	} else {
+		high_frequency_loop.stop();
+	}
+	if (handshake_pending || session_stats.sessions > 0 || !command_queue.empty() || holding_events ||
+	    eviction_requested.load(std::memory_order_relaxed)) {
+		return;
+	}
+	high_frequency_loop.stop();
+	loop_enabled = false;
+	loop_stats.sleeps++;
+	disable_loop();
+}
+#endif
+
+void
+SesameServerComponent::wake_loop() {
+#ifdef USE_SESAME_SERVER_WORKER_TASK
+	if (worker_handle) {
+		xTaskNotifyGive(worker_handle);
+	}
+#endif
+#ifdef USE_SESAME_SERVER_EVENT_DRIVEN_LOOP
+	if (event_driven_loop) {
+		enable_loop_soon_any_context();
+	}
+#endif
+}
+
+#ifdef USE_SESAME_SERVER_WORKER_TASK
+bool
+SesameServerComponent::start_worker_task() {
+	auto rc = xTaskCreatePinnedToCore(worker_task, "sesame_server", worker_stack_size, this, worker_priority, &worker_handle,
+	                                  worker_core);
+	if (rc != pdPASS) {
+		worker_handle = nullptr;
+		return false;
+	}
+	ESP_LOGI(TAG, "Worker task started on core %u", worker_core);
+	return true;
+}
+
+void
+SesameServerComponent::worker_task(void* arg) {
+	auto* self = static_cast<SesameServerComponent*>(arg);
+	for (;;) {
+		{
+			LockGuard guard{self->sesame_server_mutex};
+			self->sesame_server.update();
+		}
+		self->worker_iterations.fetch_add(1, std::memory_order_relaxed);
+		// Commands and connections notify the task to pump without waiting for the interval
+		ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(self->worker_interval_ms));
+	}
+}
+#endif
+
+void
+SesameServerComponent::release_events(const char* reason) {
+	if (!holding_events) {
+		return;
+	}
+	holding_events = false;
+	held_commands = command_queue.size();
+	cancel_timeout("event_hold");
+	ESP_LOGI(TAG, "Releasing %u held commands (%s)", static_cast<unsigned>(held_commands), reason);
+}
+
+#ifdef USE_SESAME_SERVER_TRIGGER_LATENCY
+LatencyHistogram
+SesameServerComponent::get_latency_histogram() const {
+	LatencyHistogram merged;
+	for (const auto& trig : triggers) {
+		merged.merge(trig->get_latency_histogram());
+	}
+	return merged;
+}
+#endif
+
+bool
+SesameServerComponent::has_diagnostic_sensors() const {
+#ifdef USE_SESAME_SERVER_LATENCY_SENSORS
+	if (latency_p50_sensor || latency_p99_sensor || latency_max_sensor) {
+		return true;
+	}
+#endif
+	return session_count_sensor || session_high_water_sensor || authentication_count_sensor || disconnect_count_sensor ||
+	       connect_denied_count_sensor || lock_state_retry_count_sensor || lock_state_failure_count_sensor ||
+	       loop_wakeup_count_sensor || loop_time_sensor;
+}
+
+session_stats_t
+SesameServerComponent::get_session_stats() const {
+	auto stats = session_stats;
+	stats.connect_denied = get_connect_denied_count();
+	stats.connects = get_connect_allowed_count() + stats.connect_denied;
+	return stats;
+}
+
+void
+SesameServerComponent::update_session_count() {
+	session_stats.sessions = unlisted_sessions.size() + std::count_if(std::cbegin(triggers), std::cend(triggers),
+	                                                                  [](const auto& trig) { return trig->is_connected(); });
+	active_sessions.store(session_stats.sessions, std::memory_order_relaxed);
+	unlisted_session_count.store(unlisted_sessions.size(), std::memory_order_relaxed);
+	schedule_advertising();
+	if (session_stats.sessions > session_stats.sessions_high_water) {
+		session_stats.sessions_high_water = session_stats.sessions;
+		ESP_LOGD(TAG, "Session high water mark %u/%u", session_stats.sessions_high_water, session_stats.max_sessions);
+	}
+}
+
+void
+SesameServerComponent::publish_diagnostics() {
+	if (session_count_sensor) {
+		session_count_sensor->publish_state(session_stats.sessions);
+	}
+	if (session_high_water_sensor) {
+		session_high_water_sensor->publish_state(session_stats.sessions_high_water);
+	}
+	if (authentication_count_sensor) {
+		authentication_count_sensor->publish_state(session_stats.authentications);
+	}
+	if (disconnect_count_sensor) {
+		disconnect_count_sensor->publish_state(session_stats.disconnects);
+	}
+	if (connect_denied_count_sensor) {
+		connect_denied_count_sensor->publish_state(get_connect_denied_count());
+	}
+	if (lock_state_retry_count_sensor) {
+		lock_state_retry_count_sensor->publish_state(lock_state_retry_stats.retries);
+	}
+	if (lock_state_failure_count_sensor) {
+		lock_state_failure_count_sensor->publish_state(lock_state_retry_stats.failures);
+	}
+	if (loop_wakeup_count_sensor) {
+		loop_wakeup_count_sensor->publish_state(loop_stats.wakeups);
+	}
+	if (loop_time_sensor) {
+		loop_time_sensor->publish_state(loop_stats.busy_us / 1000.0f);
+	}
+#ifdef USE_SESAME_SERVER_LATENCY_SENSORS
+	if (latency_window.get_count() > 0) {
+		if (latency_p50_sensor) {
+			latency_p50_sensor->publish_state(latency_window.percentile(0.5f) / 1000.0f);
+		}
+		if (latency_p99_sensor) {
+			latency_p99_sensor->publish_state(latency_window.percentile(0.99f) / 1000.0f);
+		}
+		if (latency_max_sensor) {
+			latency_max_sensor->publish_state(latency_window.get_max() / 1000.0f);
+		}
+		latency_window.reset();
+	}
+#endif
 }
 
 void
@@ -181,22 +707,8 @@ SesameServerComponent::reset() {
 	}
 }
 
-SesameTrigger::SesameTrigger(SesameServerComponent* server_component, std::string_view btaddr, std::string_view uuid)
-    : server_component(server_component) {
-	if (!btaddr.empty()) {
-		address = NimBLEAddress(std::string{btaddr}, BLE_ADDR_RANDOM);
-	} else if (uuid.empty()) {
-		ESP_LOGE(TAG, "Either btaddr or uuid is required.");
-		server_component->mark_failed();
-		return;
-	} else {
-		address = SesameServer::uuid_to_ble_address(NimBLEUUID{std::string{uuid}});
-	}
-	if (address.isNull()) {
-		ESP_LOGE(TAG, "Invalid btaddr or uuid.");
-		server_component->mark_failed();
-		return;
-	}
+SesameTrigger::SesameTrigger(SesameServerComponent* server_component, uint64_t key)
+    : address(key_to_address(key)), server_component(server_component) {
 #if ESPHOME_VERSION_CODE >= VERSION_CODE(2025, 11, 0)
 	set_event_types({"open", "close", "lock", "unlock"});
 #else
@@ -205,114 +717,410 @@ SesameTrigger::SesameTrigger(SesameServerComponent* server_component, std::strin
 }
 
 static float
-make_float(std::optional<history_tag_type_t> history_tag_type) {
-	if (history_tag_type.has_value()) {
-		return static_cast<float>(*history_tag_type);
+voltage_to_pct(float scaled_voltage, std::optional<history_tag_type_t> history_tag_type) {
+	if (!std::isfinite(scaled_voltage) || !history_tag_type.has_value()) {
+		return NAN;
 	}
-	return NAN;
+	return Status::scaled_voltage_to_pct(scaled_voltage, battery_model(*history_tag_type) == battery_model_t::open_sensor
+	                                                         ? Sesame::model_t::open_sensor_1
+	                                                         : Sesame::model_t::sesame_5);
 }
 
+extra_info_t
+extra_info_t::decode(std::span<const std::byte> extra) {
+	extra_info_t info;
+	if (extra.size() < 2) {
+		return info;
+	}
+	auto command = static_cast<Sesame::item_code_t>(extra[0]);
+	if (command != Sesame::item_code_t::door_open && command != Sesame::item_code_t::door_closed) {
+		return info;
+	}
+	info.command = command;
+	switch (std::to_integer<uint8_t>(extra[1])) {
+		case 0x00:
+			info.switch_state = false;
+			break;
+		case 0x01:
+			info.switch_state = true;
+			break;
+		default:  // 0xff: Open Sensor (no switch)
+			break;
+	}
+	return info;
+}
+
+trigger_text_t&
+SesameTrigger::get_text() const {
+	if (!text) {
+		text = std::make_unique<trigger_text_t>();
+	}
+	return *text;
+}
+
+const std::string&
+SesameTrigger::get_history_tag() const {
+	auto& t = get_text();
+	if (!t.history_tag_valid) {
+		t.history_tag = server_component->get_tag_table().to_string(history_tag_id);
+		t.history_tag_valid = true;
+	}
+	return t.history_tag;
+}
+
+std::optional<tag_uuid_t>
+SesameTrigger::get_history_tag_uuid() const {
+	return server_component->get_tag_table().get_uuid(history_tag_id);
+}
+
+const std::string&
+SesameTrigger::get_extra() const {
+	auto& t = get_text();
+	if (!t.extra_valid) {
+		t.extra = util::bin2hex(extra.data(), extra_len);
+		t.extra_valid = true;
+	}
+	return t.extra;
+}
+
+#ifdef SESAME_SERVER_AGGREGATE_EVENT_API
 void
-SesameTrigger::invoke(Sesame::item_code_t cmd,
-                      const std::string& tag,
-                      std::optional<history_tag_type_t> history_tag_type,
-                      float scaled_voltage,
-                      float scaled_voltage2,
-                      std::string_view extra) {
-	const char* evs = event_name(cmd);
-	if (evs[0] == 0) {
+SesameTrigger::flush_sensors() {
+	if (!sensors_pending) {
 		return;
 	}
-	history_tag = tag;
-	this->history_tag_type = make_float(history_tag_type);
-	this->scaled_voltage = scaled_voltage;
-	this->scaled_voltage2 = scaled_voltage2;
-	this->extra = util::bin2hex(extra.data(), extra.size());
-	if (std::isfinite(scaled_voltage) && history_tag_type.has_value()) {
-		battery_pct = Status::scaled_voltage_to_pct(
-		    scaled_voltage, *history_tag_type == history_tag_type_t::open_sensor || *history_tag_type == history_tag_type_t::remote_nano
-		                        ? Sesame::model_t::open_sensor_1
-		                        : Sesame::model_t::sesame_5);
-	} else {
-		battery_pct = NAN;
+	publish_sensors(get_history_tag(), pending_tag_changed);
+	sensors_pending = false;
+	pending_tag_changed = false;
+}
+#endif
+
+#ifdef SESAME_SERVER_AGGREGATE_EVENT_API
+void
+SesameTrigger::fire_aggregate_event(const char* event_type) {
+	auto* api_device = server_component->get_aggregate_event_api();
+	if (api_device == nullptr) {
+		return;
 	}
-	if (std::isfinite(scaled_voltage2) && history_tag_type.has_value()) {
-		battery_pct2 = Status::scaled_voltage_to_pct(scaled_voltage2, *history_tag_type == history_tag_type_t::open_sensor ||
-		                                                                      *history_tag_type == history_tag_type_t::remote_nano
-		                                                                  ? Sesame::model_t::open_sensor_1
-		                                                                  : Sesame::model_t::sesame_5);
-	} else {
-		battery_pct2 = NAN;
+	auto float_str = [](float value) { return std::isnan(value) ? std::string{} : std::to_string(value); };
+	auto extra_info = get_extra_info();
+	std::string command;
+	if (extra_info.command) {
+		command = event_name(*extra_info.command);
+		if (command.empty()) {
+			command = std::to_string(static_cast<uint8_t>(*extra_info.command));
+		}
+	}
+	api_device->fire_homeassistant_event(
+	    "esphome.sesame_server_trigger",
+	    {
+	        {"trigger", get_name()},
+	        {"address", address.toString()},
+	        {"event_type", event_type},
+	        {"history_tag", get_history_tag()},
+	        {"history_tag_type", float_str(history_tag_type)},
+	        {"scaled_voltage", float_str(scaled_voltage)},
+	        {"battery_pct", float_str(battery_pct)},
+	        {"scaled_voltage2", float_str(scaled_voltage2)},
+	        {"battery_pct2", float_str(battery_pct2)},
+	        {"extra", get_extra()},
+	        {"command", command},
+	        {"switch_state", extra_info.switch_state ? (*extra_info.switch_state ? "on" : "off") : ""},
+	    });
+}
+#endif
+
+#ifdef USE_SESAME_SERVER_ROUTES
+void
+SesameTrigger::add_route(uint32_t tag_hash,
+                         const char* tag,
+                         uint8_t event_mask,
+                         int16_t history_tag_type,
+                         SesameRouteTrigger* trigger) {
+	routes.add(tag_hash, tag, event_mask, history_tag_type, trigger);
+}
+
+void
+SesameTrigger::dispatch_routes(Sesame::item_code_t cmd,
+                               std::string_view tag,
+                               std::optional<history_tag_type_t> history_tag_type,
+                               const char* event_type) {
+	int16_t tag_type = history_tag_type.has_value() ? static_cast<int16_t>(*history_tag_type) : -1;
+	routes.dispatch(event_bit(cmd), tag, tag_type, [event_type](SesameRouteTrigger* trigger) { trigger->trigger(event_type); });
+}
+#endif
+
+trigger_sensors_t&
+SesameTrigger::get_sensors() {
+	if (!sensors) {
+		sensors = std::make_unique<trigger_sensors_t>();
+	}
+	return *sensors;
+}
+
+#ifdef USE_SESAME_SERVER_DEDUP
+bool
+SesameTrigger::is_duplicate(Sesame::item_code_t cmd, std::string_view tag, uint32_t received_us) {
+	// Commands may have waited in the queue (held events, busy loop), measure the window between receptions
+	auto received_ms = millis() - (micros() - received_us) / 1000;
+	return dedup.is_duplicate(static_cast<uint8_t>(cmd), fnv1a_hash(tag), received_ms);
+}
+#endif
+
+void
+SesameTrigger::publish_sensors(std::string_view tag, bool tag_changed) {
+	auto& s = *sensors;
+#ifdef USE_SESAME_SERVER_PUBLISH_CHANGES_ONLY
+	float voltage_deadband = this->voltage_deadband;
+	float battery_pct_deadband = this->battery_pct_deadband;
+	bool publish_changes_only = this->publish_changes_only;
+	// Compare with the values we published, the sensor states may have been altered by filters
+	auto& last = s.published;
+#else
+	constexpr float voltage_deadband = 0.0f;
+	constexpr float battery_pct_deadband = 0.0f;
+	constexpr bool publish_changes_only = false;
+	published_values_t last;  // not compared
+#endif
+	auto extra_bytes = get_extra_bytes();
+	auto extra_info = get_extra_info();
+	// decide which sensors to publish
+	bool pub_history_tag = s.history_tag && (!publish_changes_only || tag_changed);
+	bool pub_history_tag_type =
+	    s.history_tag_type && (!publish_changes_only || float_changed(last.history_tag_type, history_tag_type, 0.0f));
+	bool pub_scaled_voltage =
+	    s.scaled_voltage && (!publish_changes_only || float_changed(last.scaled_voltage, scaled_voltage, voltage_deadband));
+	bool pub_battery_pct =
+	    s.battery_pct && (!publish_changes_only || float_changed(last.battery_pct, battery_pct, battery_pct_deadband));
+	bool pub_scaled_voltage2 =
+	    s.scaled_voltage2 && (!publish_changes_only || float_changed(last.scaled_voltage2, scaled_voltage2, voltage_deadband));
+	bool pub_battery_pct2 =
+	    s.battery_pct2 && (!publish_changes_only || float_changed(last.battery_pct2, battery_pct2, battery_pct_deadband));
+	bool pub_extra =
+	    s.extra && (!publish_changes_only || !std::equal(std::cbegin(extra_bytes), std::cend(extra_bytes), std::cbegin(last.extra),
+	                                                     std::cbegin(last.extra) + last.extra_len));
+	bool pub_switch_state = s.switch_state && extra_info.switch_state.has_value() &&
+	                        (!publish_changes_only || last.switch_state != extra_info.switch_state);
+	if (publish_changes_only) {
+		if (pub_history_tag_type) {
+			last.history_tag_type = history_tag_type;
+		}
+		if (pub_scaled_voltage) {
+			last.scaled_voltage = scaled_voltage;
+		}
+		if (pub_battery_pct) {
+			last.battery_pct = battery_pct;
+		}
+		if (pub_scaled_voltage2) {
+			last.scaled_voltage2 = scaled_voltage2;
+		}
+		if (pub_battery_pct2) {
+			last.battery_pct2 = battery_pct2;
+		}
+		if (pub_extra) {
+			std::copy(std::cbegin(extra_bytes), std::cend(extra_bytes), std::begin(last.extra));
+			last.extra_len = extra_bytes.size();
+		}
+		if (pub_switch_state) {
+			last.switch_state = extra_info.switch_state;
+		}
 	}
 	// set all sensor states
-	if (history_tag_sensor) {
-		history_tag_sensor->state = tag;
+	if (pub_history_tag) {
+		s.history_tag->state = tag;
 	}
-	if (history_tag_type_sensor) {
-		history_tag_type_sensor->state = this->history_tag_type;
+	if (pub_history_tag_type) {
+		s.history_tag_type->state = history_tag_type;
 	}
-	if (scaled_voltage_sensor) {
-		scaled_voltage_sensor->state = this->scaled_voltage;
+	if (pub_scaled_voltage) {
+		s.scaled_voltage->state = scaled_voltage;
 	}
-	if (battery_pct_sensor) {
-		battery_pct_sensor->state = this->battery_pct;
+	if (pub_battery_pct) {
+		s.battery_pct->state = battery_pct;
 	}
-	if (scaled_voltage2_sensor) {
-		scaled_voltage2_sensor->state = this->scaled_voltage2;
+	if (pub_scaled_voltage2) {
+		s.scaled_voltage2->state = scaled_voltage2;
 	}
-	if (battery_pct2_sensor) {
-		battery_pct2_sensor->state = this->battery_pct2;
+	if (pub_battery_pct2) {
+		s.battery_pct2->state = battery_pct2;
 	}
-	if (extra_sensor) {
-		extra_sensor->state = this->extra;
+	if (pub_extra) {
+		s.extra->state = get_extra();
+	}
+	if (pub_switch_state) {
+		s.switch_state->state = *extra_info.switch_state;
 	}
 	// publish all sensor states
-	if (history_tag_sensor) {
-		history_tag_sensor->publish_state(history_tag_sensor->state);
+	if (pub_history_tag) {
+		s.history_tag->publish_state(s.history_tag->state);
+	}
+	if (pub_history_tag_type) {
+		s.history_tag_type->publish_state(s.history_tag_type->state);
+	}
+	if (pub_scaled_voltage) {
+		s.scaled_voltage->publish_state(s.scaled_voltage->state);
+	}
+	if (pub_battery_pct) {
+		s.battery_pct->publish_state(s.battery_pct->state);
+	}
+	if (pub_scaled_voltage2) {
+		s.scaled_voltage2->publish_state(s.scaled_voltage2->state);
+	}
+	if (pub_battery_pct2) {
+		s.battery_pct2->publish_state(s.battery_pct2->state);
+	}
+	if (pub_extra) {
+		s.extra->publish_state(s.extra->state);
 	}
-	if (history_tag_type_sensor) {
-		history_tag_type_sensor->publish_state(history_tag_type_sensor->state);
+	if (pub_switch_state) {
+		s.switch_state->publish_state(s.switch_state->state);
 	}
-	if (scaled_voltage_sensor) {
-		scaled_voltage_sensor->publish_state(scaled_voltage_sensor->state);
+}
+
+bool
+SesameTrigger::invoke(Sesame::item_code_t cmd,
+                      std::string_view tag,
+                      std::optional<history_tag_type_t> history_tag_type,
+                      float scaled_voltage,
+                      float scaled_voltage2,
+                      std::string_view extra,
+                      uint32_t received_us,
+                      uint32_t dequeued_us) {
+	const char* evs = event_name(cmd);
+	if (evs[0] == 0) {
+		return false;
 	}
-	if (battery_pct_sensor) {
-		battery_pct_sensor->publish_state(battery_pct_sensor->state);
+#ifdef USE_SESAME_SERVER_DEDUP
+	if (is_duplicate(cmd, tag, received_us)) {
+		ESP_LOGD(TAG, "Duplicated %s to %s suppressed", evs, get_name().c_str());
+		return false;
 	}
-	if (scaled_voltage2_sensor) {
-		scaled_voltage2_sensor->publish_state(scaled_voltage2_sensor->state);
+#endif
+	auto tag_id = server_component->get_tag_table().intern(tag);
+	// Without an id, the previous tag is either empty or kept in text
+	std::string_view previous_tag;
+	if (history_tag_id == TagTable::NO_TAG && text && text->history_tag_valid) {
+		previous_tag = text->history_tag;
 	}
-	if (battery_pct2_sensor) {
-		battery_pct2_sensor->publish_state(battery_pct2_sensor->state);
+	bool tag_changed = tag_id != history_tag_id || (tag_id == TagTable::NO_TAG && previous_tag != tag);
+	history_tag_id = tag_id;
+	if (tag_id == TagTable::NO_TAG && !tag.empty()) {
+		// Did not fit in the tag table
+		auto& t = get_text();
+		t.history_tag = tag;
+		t.history_tag_valid = true;
+	} else if (tag_changed && text) {
+		text->history_tag_valid = false;  // formatted again by get_history_tag()
 	}
-	if (extra_sensor) {
-		extra_sensor->publish_state(extra_sensor->state);
+	this->history_tag_type = make_float(history_tag_type);
+	this->scaled_voltage = scaled_voltage;
+	this->scaled_voltage2 = scaled_voltage2;
+	extra_len = std::min(extra.size(), this->extra.size());
+	if (text) {
+		text->extra_valid = false;
+	}
+	std::transform(std::cbegin(extra), std::cbegin(extra) + extra_len, std::begin(this->extra),
+	               [](char c) { return static_cast<std::byte>(c); });
+	battery_pct = voltage_to_pct(scaled_voltage, history_tag_type);
+	battery_pct2 = voltage_to_pct(scaled_voltage2, history_tag_type);
+	if (sensors) {
+#ifdef SESAME_SERVER_AGGREGATE_EVENT_API
+		if (aggregate_event) {
+			sensors_pending = true;
+			pending_tag_changed |= tag_changed;
+		} else {
+			publish_sensors(tag, tag_changed);
+		}
+#else
+		publish_sensors(tag, tag_changed);
+#endif
 	}
 	ESP_LOGD(TAG, "Triggering %s to %s", evs, get_name().c_str());
+	auto triggering_us = micros();
+	// Unused without USE_SESAME_SERVER_TRIGGER_LATENCY when verbose logging compiles away
+	[[maybe_unused]] uint32_t queue_us = dequeued_us - received_us;
+	[[maybe_unused]] uint32_t publish_us = triggering_us - dequeued_us;
+	uint32_t total_us = triggering_us - received_us;
+	// The time held by early_start would swamp the histograms, it is only seen in the last latency
+	bool held = server_component->is_delivering_held_command();
+	if (!held) {
+		server_component->record_command_latency(total_us);
+	}
+#ifdef USE_SESAME_SERVER_TRIGGER_LATENCY
+	last_latency.queue_us = queue_us;
+	last_latency.publish_us = publish_us;
+	last_latency.total_us = total_us;
+	if (!held) {
+		latency_histogram.record(total_us);
+	}
+#endif
 	trigger(evs);
+#ifdef SESAME_SERVER_AGGREGATE_EVENT_API
+	if (aggregate_event) {
+		fire_aggregate_event(evs);
+	}
+#endif
+#ifdef USE_SESAME_SERVER_ROUTES
+	dispatch_routes(cmd, tag, history_tag_type, evs);
+#endif
+	[[maybe_unused]] uint32_t trigger_us = micros() - triggering_us;
+#ifdef USE_SESAME_SERVER_TRIGGER_LATENCY
+	last_latency.trigger_us = trigger_us;
+#endif
+	ESP_LOGV(TAG, "%s latency: queue=%" PRIu32 "us publish=%" PRIu32 "us total=%" PRIu32 "us trigger=%" PRIu32 "us",
+	         get_name().c_str(), queue_us, publish_us, total_us, trigger_us);
+	return true;
 }
 
 void
 SesameServerComponent::disconnect(const NimBLEAddress& addr) {
 	if (has_session(addr)) {
 		ESP_LOGI(TAG, "Disconnecting %s", addr.toString().c_str());
+		ServerLock lock{sesame_server_mutex};
 		sesame_server.disconnect(addr);
 	}
 }
 
 bool
 SesameServerComponent::has_session(const NimBLEAddress& addr) const {
+	ServerLock lock{sesame_server_mutex};
 	return server_started && sesame_server.has_session(addr);
 }
 
 bool
 SesameServerComponent::has_trigger(const NimBLEAddress& addr) const {
-	return std::any_of(std::cbegin(triggers), std::cend(triggers),
-	                   [&addr](const auto& trigger) { return trigger->get_address() == addr; });
+	return find_trigger(addr) != nullptr;
+}
+
+void
+SesameServerComponent::add_trigger(SesameTrigger* trigger) {
+	trigger->set_index(triggers.size());
+	if (!triggers.empty() && address_key(triggers.back()->get_address()) >= address_key(trigger->get_address())) {
+		ESP_LOGE(TAG, "%s: %s is not in ascending address order after %s", trigger->get_address().toString().c_str(),
+		         trigger->get_name().c_str(), triggers.back()->get_name().c_str());
+		unsorted_triggers = true;
+	}
+	triggers.emplace_back(trigger);
+}
+
+SesameTrigger*
+SesameServerComponent::find_trigger(const NimBLEAddress& addr) const {
+	auto key = address_key(addr);
+	auto pos = std::lower_bound(std::cbegin(triggers), std::cend(triggers), key,
+	                            [](const auto& trig, uint64_t key) { return address_key(trig->get_address()) < key; });
+	if (pos == std::cend(triggers) || address_key((*pos)->get_address()) != key) {
+		return nullptr;
+	}
+	return pos->get();
 }
 
 void
 SesameServerComponent::start_advertising() {
+	advertising_stopped = false;
+	if (advertising_scheduler && advertising_mode == advertising_mode_t::paused) {
+		return;
+	}
+	ServerLock lock{sesame_server_mutex};
 	if (!sesame_server.start_advertising()) {
 		ESP_LOGW(TAG, "Failed to start advertising");
 	}
@@ -320,29 +1128,154 @@ SesameServerComponent::start_advertising() {
 
 void
 SesameServerComponent::stop_advertising() {
+	advertising_stopped = true;
+	ServerLock lock{sesame_server_mutex};
 	if (!sesame_server.stop_advertising()) {
 		ESP_LOGW(TAG, "Failed to stop advertising");
 	}
 }
 
+bool
+SesameServerComponent::apply_advertising_interval(uint32_t interval_ms) {
+	auto* adv = NimBLEDevice::getAdvertising();
+	if (!adv) {
+		return false;
+	}
+	// 0.625ms units
+	auto interval = static_cast<uint16_t>(std::clamp<uint32_t>(interval_ms * 8 / 5, 0x20, 0x4000));
+	adv->setMinInterval(interval);
+	adv->setMaxInterval(interval);
+	return true;
+}
+
+void
+SesameServerComponent::set_advertising_mode(advertising_mode_t mode) {
+	if (mode == advertising_mode) {
+		return;
+	}
+	ESP_LOGD(TAG, "Advertising mode %u -> %u", static_cast<uint8_t>(advertising_mode), static_cast<uint8_t>(mode));
+	advertising_mode = mode;
+	if (!server_started || advertising_stopped) {
+		return;
+	}
+	ServerLock lock{sesame_server_mutex};
+	sesame_server.stop_advertising();
+	if (mode == advertising_mode_t::paused) {
+		return;
+	}
+	apply_advertising_interval(mode == advertising_mode_t::fast ? fast_advertising_interval_ms : slow_advertising_interval_ms);
+	if (!sesame_server.start_advertising()) {
+		ESP_LOGW(TAG, "Failed to start advertising");
+	}
+}
+
+void
+SesameServerComponent::start_fast_advertising() {
+	if (!advertising_scheduler) {
+		return;
+	}
+	if (pause_advertising_when_full && is_full()) {
+		cancel_timeout("advertising");
+		set_advertising_mode(advertising_mode_t::paused);
+		return;
+	}
+	set_advertising_mode(advertising_mode_t::fast);
+	set_timeout("advertising", fast_advertising_duration_ms, [this]() { set_advertising_mode(advertising_mode_t::slow); });
+}
+
+bool
+SesameServerComponent::is_full() const {
+	// Unlisted sessions give way to a connecting trigger (see check_admission), keep advertising while one may show up
+	bool evictable = !unlisted_sessions.empty() &&
+	                 std::any_of(std::cbegin(triggers), std::cend(triggers), [](const auto& trig) { return !trig->is_connected(); });
+	return session_stats.sessions - (evictable ? unlisted_sessions.size() : 0) >= session_stats.max_sessions;
+}
+
+void
+SesameServerComponent::schedule_advertising() {
+	if (!advertising_scheduler) {
+		return;
+	}
+	if (pause_advertising_when_full && is_full()) {
+		cancel_timeout("advertising");
+		set_advertising_mode(advertising_mode_t::paused);
+	} else if (advertising_mode == advertising_mode_t::paused) {
+		start_fast_advertising();
+	}
+}
+
 void
 StatusLockWrapper::init() {
 #if ESPHOME_VERSION_CODE >= VERSION_CODE(2026, 4, 0)
-	lock_.add_on_state_callback([this](lock::LockState state) {
+	lock_.add_on_state_callback([this]([[maybe_unused]] lock::LockState state) {
 #else
 	lock_.add_on_state_callback([this]() {
 #endif
 		ESP_LOGV(TAG, "Lock callback called");
-		if (!std::visit([this](auto& x) { return x.get().send_lock_state(lock_.state); }, parent_)) {
+		if (server().get_lock_state_coalesce() > 0) {
+			pending_ = true;
+			server().schedule_lock_state_flush();
+			return;
+		}
+		if (!send()) {
 			ESP_LOGW(TAG, "Failed to send lock state to trigger device");
 		}
 	});
 }
 
 bool
-SesameTrigger::send_lock_state(lock::LockState state) {
+StatusLockWrapper::send() {
+	return std::visit([this](auto& x) { return x.get().send_lock_state(lock_.state); }, parent_);
+}
+
+bool
+StatusLockWrapper::send_if_pending() {
+	if (!pending_) {
+		return true;
+	}
+	pending_ = false;
+	return send();
+}
+
+SesameServerComponent&
+StatusLockWrapper::server() {
+	if (auto* trigger = std::get_if<std::reference_wrapper<SesameTrigger>>(&parent_)) {
+		return trigger->get().get_server_component();
+	}
+	return std::get<std::reference_wrapper<SesameServerComponent>>(parent_).get();
+}
+
+bool
+SesameTrigger::send_lock_state(lock::LockState state, bool force) {
 	ESP_LOGV(TAG, "send_lock_state on trigger");
-	return server_component->send_lock_state(&address, state);
+	return server_component->send_lock_state(&address, state, force);
+}
+
+void
+SesameTrigger::flush_lock_state() {
+	if (lock_entity && !lock_entity->send_if_pending()) {
+		ESP_LOGW(TAG, "Failed to send lock state to %s", get_address().toString().c_str());
+	}
+}
+
+void
+SesameServerComponent::schedule_lock_state_flush() {
+	if (lock_state_flush_scheduled) {
+		return;
+	}
+	lock_state_flush_scheduled = true;
+	set_timeout("lock_state", lock_state_coalesce_ms, [this]() { flush_lock_states(); });
+}
+
+void
+SesameServerComponent::flush_lock_states() {
+	lock_state_flush_scheduled = false;
+	if (lock_entity && !lock_entity->send_if_pending()) {
+		ESP_LOGW(TAG, "Failed to send lock state to trigger device");
+	}
+	for (auto& trig : triggers) {
+		trig->flush_lock_state();
+	}
 }
 
 bool
@@ -352,16 +1285,16 @@ SesameServerComponent::send_lock_state(lock::LockState state) {
 }
 
 bool
-SesameServerComponent::send_current_lock_state(const NimBLEAddress& address) {
+SesameServerComponent::send_current_lock_state(const NimBLEAddress& address, bool force) {
 	if (lock_entity) {
-		return send_lock_state(&address, lock_entity->get_state());
+		return send_lock_state(&address, lock_entity->get_state(), force);
 	} else {
 		return true;
 	}
 }
 
-bool
-SesameServerComponent::send_lock_state(const NimBLEAddress* address, lock::LockState state) {
+static Sesame::mecha_status_5_t
+make_mecha_status(lock::LockState state) {
 	Sesame::mecha_status_5_t sst{};
 
 	sst.battery = 3 * 1000;  // dummy voltage
@@ -420,12 +1353,172 @@ SesameServerComponent::send_lock_state(const NimBLEAddress* address, lock::LockS
 			sst.is_stop = true;
 			break;
 	}
+	return sst;
+}
+
+lock_state_delivery_t*
+SesameServerComponent::find_lock_state_delivery(const NimBLEAddress& addr) {
+	if (auto trig = find_trigger(addr)) {
+		return &trig->get_lock_state_delivery();
+	}
+	if (auto* session = find_unlisted_session(addr)) {
+		return &session->lock_state_delivery;
+	}
+	return nullptr;
+}
+
+SesameServerComponent::unlisted_session_t*
+SesameServerComponent::find_unlisted_session(const NimBLEAddress& addr) {
+	if (auto it = std::find_if(std::begin(unlisted_sessions), std::end(unlisted_sessions),
+	                           [&addr](const auto& session) { return session.address == addr; });
+	    it != std::end(unlisted_sessions)) {
+		return &*it;
+	}
+	return nullptr;
+}
+
+bool
+SesameServerComponent::deliver_lock_state(const NimBLEAddress& addr,
+                                          lock_state_delivery_t& delivery,
+                                          const Sesame::mecha_status_5_t& status,
+                                          lock::LockState state,
+                                          bool force) {
+	if (delivery.pending && *delivery.pending != state) {
+		// The newer state is sent now, it only becomes pending if this send fails
+		lock_state_retry_stats.superseded++;
+		delivery.clear_pending();
+	}
+	if (!force && delivery.last_sent == state) {
+		ESP_LOGV(TAG, "Lock state %s already sent to %s", LOG_STR_ARG(lock::lock_state_to_string(state)), addr.toString().c_str());
+		lock_state_skipped_count++;
+		delivery.clear_pending();
+		return true;
+	}
+	ESP_LOGD(TAG, "Sending lock state %s to %s", LOG_STR_ARG(lock::lock_state_to_string(state)), addr.toString().c_str());
+	bool sent;
+	{
+		ServerLock lock{sesame_server_mutex};
+		sent = sesame_server.send_mecha_status(&addr, status);
+	}
+#ifdef USE_SESAME_SERVER_TRACE
+	if (auto* rec = trace(trace_event_t::lock_state, addr)) {
+		rec->code = static_cast<uint8_t>(state);
+		rec->result = sent;
+	}
+#endif
+	if (!sent) {
+		delivery.last_sent.reset();
+		schedule_lock_state_retry(addr, delivery, state);
+		return false;
+	}
+	delivery.last_sent = state;
+	if (delivery.pending) {
+		auto elapsed = millis() - delivery.first_failure_ms;
+		lock_state_retry_stats.redelivered++;
+		lock_state_retry_stats.last_redelivery_ms = elapsed;
+		lock_state_retry_stats.max_redelivery_ms = std::max(lock_state_retry_stats.max_redelivery_ms, elapsed);
+		ESP_LOGD(TAG, "Lock state redelivered to %s after %" PRIu32 "ms", addr.toString().c_str(), elapsed);
+		delivery.clear_pending();
+	}
+	if (auto* session = find_unlisted_session(addr)) {
+		session->last_activity = millis();
+	}
+	return true;
+}
+
+void
+SesameServerComponent::schedule_lock_state_retry(const NimBLEAddress& addr,
+                                                 lock_state_delivery_t& delivery,
+                                                 lock::LockState state) {
+	if (lock_state_retry_max_attempts == 0) {
+		return;
+	}
+	auto now = millis();
+	if (!delivery.pending) {
+		delivery.first_failure_ms = now;
+		delivery.attempts = 0;
+	}
+	delivery.pending = state;
+	if (++delivery.attempts > lock_state_retry_max_attempts) {
+		ESP_LOGW(TAG, "Giving up sending lock state %s to %s", LOG_STR_ARG(lock::lock_state_to_string(state)),
+		         addr.toString().c_str());
+		lock_state_retry_stats.failures++;
+		delivery.clear_pending();
+		return;
+	}
+	auto shift = std::min<unsigned>(delivery.attempts - 1, 16);
+	delivery.next_retry_ms = now + std::min(lock_state_retry_initial_ms << shift, lock_state_retry_max_ms);
+	arm_lock_state_retry();
+}
 
-	sesame_server.set_mecha_status(sst);
+void
+SesameServerComponent::arm_lock_state_retry() {
+	auto now = millis();
+	std::optional<uint32_t> delay;
+	auto earliest = [&](const lock_state_delivery_t& delivery) {
+		if (!delivery.pending) {
+			return;
+		}
+		int32_t remaining = static_cast<int32_t>(delivery.next_retry_ms - now);
+		uint32_t d = remaining > 0 ? remaining : 0;
+		if (!delay || d < *delay) {
+			delay = d;
+		}
+	};
+	for (auto& trig : triggers) {
+		earliest(trig->get_lock_state_delivery());
+	}
+	for (const auto& session : unlisted_sessions) {
+		earliest(session.lock_state_delivery);
+	}
+	if (delay) {
+		set_timeout("lock_state_retry", *delay, [this]() { retry_lock_states(); });
+	} else {
+		cancel_timeout("lock_state_retry");
+	}
+}
+
+void
+SesameServerComponent::retry_lock_states() {
+	auto now = millis();
+	auto retry = [this, now](const NimBLEAddress& addr, lock_state_delivery_t& delivery) {
+		if (!delivery.pending || static_cast<int32_t>(now - delivery.next_retry_ms) < 0) {
+			return;
+		}
+		if (!has_session(addr)) {
+			delivery.reset();
+			return;
+		}
+		auto state = *delivery.pending;
+		lock_state_retry_stats.retries++;
+		ESP_LOGD(TAG, "Retrying lock state %s to %s (attempt %u)", LOG_STR_ARG(lock::lock_state_to_string(state)),
+		         addr.toString().c_str(), delivery.attempts + 1u);
+		deliver_lock_state(addr, delivery, make_mecha_status(state), state, true);
+	};
+	for (auto& trig : triggers) {
+		retry(trig->get_address(), trig->get_lock_state_delivery());
+	}
+	for (auto& session : unlisted_sessions) {
+		retry(session.address, session.lock_state_delivery);
+	}
+	arm_lock_state_retry();
+}
+
+bool
+SesameServerComponent::send_lock_state(const NimBLEAddress* address, lock::LockState state, bool force) {
+	auto sst = make_mecha_status(state);
+	{
+		ServerLock lock{sesame_server_mutex};
+		sesame_server.set_mecha_status(sst);
+	}
 
 	if (address) {
 		if (has_session(*address)) {
+			if (auto* delivery = find_lock_state_delivery(*address)) {
+				return deliver_lock_state(*address, *delivery, sst, state, force);
+			}
 			ESP_LOGD(TAG, "Sending lock state %s to %s", LOG_STR_ARG(lock::lock_state_to_string(state)), address->toString().c_str());
+			ServerLock lock{sesame_server_mutex};
 			return sesame_server.send_mecha_status(address, sst);
 		} else {
 			ESP_LOGW(TAG, "No session for address %s, cannot send lock status", address->toString().c_str());
@@ -440,9 +1533,7 @@ SesameServerComponent::send_lock_state(const NimBLEAddress* address, lock::LockS
 		for (auto& trig : triggers) {
 			ESP_LOGV(TAG, "Checking trigger %s", trig->get_address().toString().c_str());
 			if (!trig->has_lock_entity() && has_session(trig->get_address())) {
-				ESP_LOGD(TAG, "Sending lock state %s to %s", LOG_STR_ARG(lock::lock_state_to_string(state)),
-				         trig->get_address().toString().c_str());
-				if (!sesame_server.send_mecha_status(&trig->get_address(), sst)) {
+				if (!deliver_lock_state(trig->get_address(), trig->get_lock_state_delivery(), sst, state, force)) {
 					ESP_LOGW(TAG, "Failed to send lock status to %s", trig->get_address().toString().c_str());
 					rc = false;
 				}
@@ -455,14 +1546,12 @@ SesameServerComponent::send_lock_state(const NimBLEAddress* address, lock::LockS
 		// Also notify authenticated sessions that are not configured as triggers.
 		// This lets clients such as the official app receive live state updates
 		// without changing the existing trigger-specific routing semantics.
-		for (const auto& addr : unlisted_sessions) {
-			if (!has_session(addr)) {
+		for (auto& session : unlisted_sessions) {
+			if (!has_session(session.address)) {
 				continue;
 			}
-			ESP_LOGD(TAG, "Sending lock state %s to unlisted session %s", LOG_STR_ARG(lock::lock_state_to_string(state)),
-			         addr.toString().c_str());
-			if (!sesame_server.send_mecha_status(&addr, sst)) {
-				ESP_LOGW(TAG, "Failed to send lock status to unlisted session %s", addr.toString().c_str());
+			if (!deliver_lock_state(session.address, session.lock_state_delivery, sst, state, force)) {
+				ESP_LOGW(TAG, "Failed to send lock status to unlisted session %s", session.address.toString().c_str());
 				rc = false;
 			}
 		}
@@ -471,47 +1560,285 @@ SesameServerComponent::send_lock_state(const NimBLEAddress* address, lock::LockS
 	}
 }
 
+#ifdef USE_SESAME_SERVER_EVENT_HISTORY
+void
+SesameServerComponent::record_event(const SesameTrigger& trigger, const command_event_t& ev) {
+	auto* rec = event_history.push();
+	if (!rec) {
+		return;
+	}
+	rec->seq = ++event_history_seq;
+	rec->time_ms = millis() - (micros() - ev.received_us) / 1000;
+	rec->scaled_voltage = ev.scaled_voltage;
+	rec->scaled_voltage2 = ev.scaled_voltage2;
+	rec->trigger_index = trigger.get_index();
+	rec->item_code = static_cast<uint8_t>(ev.item_code);
+	rec->history_tag_type = ev.history_tag_type ? static_cast<uint8_t>(*ev.history_tag_type) : 0xff;
+	rec->tag_len = ev.tag_len;
+	std::copy(ev.tag, ev.tag + ev.tag_len, std::begin(rec->tag));
+}
+
+#ifdef SESAME_SERVER_EVENT_HISTORY_SERVICE
+uint32_t
+SesameServerComponent::send_event_history(uint32_t since, size_t max_count) {
+	uint32_t last_seq = since;
+	size_t sent = 0;
+	auto now = millis();
+	for (size_t i = 0; i < event_history.size() && sent < max_count; i++) {
+		const auto& rec = event_history.at(i);
+		if (rec.seq <= since) {
+			continue;
+		}
+		auto* trig = get_trigger(rec.trigger_index);
+		event_history_service->fire_homeassistant_event(
+		    "esphome.sesame_server_event",
+		    {
+		        {"seq", std::to_string(rec.seq)},
+		        {"age_ms", std::to_string(now - rec.time_ms)},
+		        {"trigger", trig ? trig->get_name() : std::string{}},
+		        {"trigger_index", std::to_string(rec.trigger_index)},
+		        {"event_type", event_name(static_cast<Sesame::item_code_t>(rec.item_code))},
+		        {"history_tag", std::string{rec.get_tag()}},
+		        {"history_tag_type", rec.history_tag_type == 0xff ? std::string{} : std::to_string(rec.history_tag_type)},
+		        {"scaled_voltage", std::isnan(rec.scaled_voltage) ? std::string{} : std::to_string(rec.scaled_voltage)},
+		        {"scaled_voltage2", std::isnan(rec.scaled_voltage2) ? std::string{} : std::to_string(rec.scaled_voltage2)},
+		    });
+		last_seq = rec.seq;
+		sent++;
+	}
+	return last_seq;
+}
+
+void
+EventHistoryService::on_get_events(int32_t since) {
+	uint32_t from = since < 0 ? 0 : since;
+	auto last_seq = server.send_event_history(from, EVENT_HISTORY_MAX_EVENTS_PER_CALL);
+	ESP_LOGD(TAG, "Sent history events after seq %" PRIu32 " up to %" PRIu32 ", latest %" PRIu32, from, last_seq,
+	         server.get_event_history_seq());
+}
+#endif
+#endif
+
+#ifdef USE_SESAME_SERVER_TRACE
+trace_record_t*
+SesameServerComponent::trace(trace_event_t event, const NimBLEAddress& addr) {
+	auto* rec = trace_buffer.push();
+	if (rec) {
+		rec->address = address_key(addr);
+		rec->time_us = micros();
+		rec->event = event;
+		rec->history_tag_type = 0xff;
+		rec->scaled_voltage = NAN;
+		rec->scaled_voltage2 = NAN;
+	}
+	return rec;
+}
+
+void
+SesameServerComponent::dump_trace() {
+	ESP_LOGI(TAG, "Trace: %u records (%" PRIu32 " overwritten)", static_cast<unsigned>(trace_buffer.size()),
+	         trace_buffer.get_overwritten());
+	for (size_t i = 0; i < trace_buffer.size(); i++) {
+		const auto& rec = trace_buffer.at(i);
+		char addr[24];
+		snprintf(addr, sizeof(addr), "%02x:%02x:%02x:%02x:%02x:%02x/%u", static_cast<uint8_t>(rec.address >> 40),
+		         static_cast<uint8_t>(rec.address >> 32), static_cast<uint8_t>(rec.address >> 24),
+		         static_cast<uint8_t>(rec.address >> 16), static_cast<uint8_t>(rec.address >> 8), static_cast<uint8_t>(rec.address),
+		         static_cast<unsigned>(rec.address >> 48));
+		switch (rec.event) {
+			case trace_event_t::connect:
+				ESP_LOGI(TAG, "T %" PRIu32 " %s connect", rec.time_us, addr);
+				break;
+			case trace_event_t::disconnect:
+				ESP_LOGI(TAG, "T %" PRIu32 " %s disconnect %d", rec.time_us, addr, rec.result);
+				break;
+			case trace_event_t::command:
+				ESP_LOGI(TAG, "T %" PRIu32 " %s command %u %u %.3f %.3f \"%.*s\" %s", rec.time_us, addr, rec.code,
+				         rec.history_tag_type, rec.scaled_voltage, rec.scaled_voltage2, static_cast<int>(rec.tag_len), rec.tag.data(),
+				         util::bin2hex(rec.extra.data(), rec.extra_len).c_str());
+				break;
+			case trace_event_t::lock_state:
+				ESP_LOGI(TAG, "T %" PRIu32 " %s lock_state %s %d", rec.time_us, addr,
+				         LOG_STR_ARG(lock::lock_state_to_string(static_cast<lock::LockState>(rec.code))), rec.result);
+				break;
+		}
+	}
+}
+#endif
+
 void
 SesameServerComponent::on_connected(const NimBLEAddress& addr) {
 	if (!sesame_server.is_registered()) {
 		return;
 	}
-	if (auto trig = std::find_if(std::cbegin(triggers), std::cend(triggers),
-	                             [&addr](const auto& trigger) { return trigger->get_address() == addr; });
-	    trig != std::cend(triggers)) {
-		(*trig)->update_connected(true);
-		ESP_LOGI(TAG, "%s (%s) connected", addr.toString().c_str(), (*trig)->get_name().c_str());
+	session_stats.authentications++;
+#ifdef USE_SESAME_SERVER_TRACE
+	trace(trace_event_t::connect, addr);
+#endif
+#ifdef USE_SESAME_SERVER_EVENT_DRIVEN_LOOP
+	// The connection may complete before loop() sees the allowed count change, which must not start a handshake afterwards
+	seen_connect_allowed_count = get_connect_allowed_count();
+	handshake_pending = false;
+	wake_loop();
+#endif
+	if (auto trig = find_trigger(addr); trig != nullptr) {
+		trig->update_connected(true);
+		ESP_LOGI(TAG, "%s (%s) connected", addr.toString().c_str(), trig->get_name().c_str());
+		apply_connection_profile(addr, trig->get_connection_profile());
 	} else {
 		ESP_LOGI(TAG, "%s (unlisted) connected, send current lock state", addr.toString().c_str());
 
-		if (std::find(unlisted_sessions.begin(), unlisted_sessions.end(), addr) == unlisted_sessions.end()) {
-			unlisted_sessions.push_back(addr);
+		if (auto* session = find_unlisted_session(addr)) {
+			session->lock_state_delivery.reset();
+			session->last_activity = millis();
+		} else {
+			unlisted_sessions.push_back({addr, {}, millis()});
 			ESP_LOGD(TAG, "Added unlisted session %s", addr.toString().c_str());
 		}
+		apply_connection_profile(addr, unlisted_connection_profile);
 
 		// Send the current mecha status immediately after authentication/login.
 		if (!send_current_lock_state(addr)) {
 			ESP_LOGW(TAG, "Failed to send lock state to unlisted device %s", addr.toString().c_str());
 		}
 	}
+	update_session_count();
+}
+
+void
+SesameServerComponent::apply_connection_profile(const NimBLEAddress& addr, connection_profile_t profile) {
+	if (profile == connection_profile_t::none) {
+		return;
+	}
+	auto* server = NimBLEDevice::getServer();
+	if (server == nullptr) {
+		return;
+	}
+	auto info = server->getPeerInfo(addr);
+	if (info.getIdAddress() != addr && info.getAddress() != addr) {
+		ESP_LOGW(TAG, "%s: Connection not found, connection profile not applied", addr.toString().c_str());
+		session_stats.connection_profile_failures++;
+		return;
+	}
+	const auto& params = CONNECTION_PROFILES[static_cast<size_t>(profile)];
+	server->updateConnParams(info.getConnHandle(), params.min_interval, params.max_interval, params.latency, params.timeout);
+	session_stats.connection_profiles[static_cast<size_t>(profile)]++;
+	ESP_LOGD(TAG, "%s: Requested %s connection parameters (interval %u-%u, latency %u, timeout %u)", addr.toString().c_str(),
+	         connection_profile_name(profile), params.min_interval, params.max_interval, params.latency, params.timeout);
 }
 
 void
 SesameServerComponent::on_disconnect(const NimBLEAddress& addr, int reason) {
-	if (auto trig = std::find_if(std::cbegin(triggers), std::cend(triggers),
-	                             [&addr](const auto& trigger) { return trigger->get_address() == addr; });
-	    trig != std::cend(triggers)) {
-		(*trig)->update_connected(false);
-		ESP_LOGI(TAG, "%s (%s) disconnected, reason=%d", addr.toString().c_str(), (*trig)->get_name().c_str(), reason);
+	session_stats.disconnects++;
+#ifdef USE_SESAME_SERVER_TRACE
+	if (auto* rec = trace(trace_event_t::disconnect, addr)) {
+		rec->result = reason;
+	}
+#endif
+	session_stats.disconnects_by_reason[static_cast<size_t>(classify_disconnect_reason(reason))]++;
+	if (auto trig = find_trigger(addr); trig != nullptr) {
+		trig->update_connected(false);
+		ESP_LOGI(TAG, "%s (%s) disconnected, reason=%d", addr.toString().c_str(), trig->get_name().c_str(), reason);
 	} else {
 		ESP_LOGI(TAG, "%s (unlisted) disconnected, reason=%d", addr.toString().c_str(), reason);
-		unlisted_sessions.erase(std::remove(unlisted_sessions.begin(), unlisted_sessions.end(), addr), unlisted_sessions.end());
+		unlisted_sessions.erase(std::remove_if(unlisted_sessions.begin(), unlisted_sessions.end(),
+		                                       [&addr](const auto& session) { return session.address == addr; }),
+		                        unlisted_sessions.end());
 		ESP_LOGD(TAG, "Removed unlisted session %s", addr.toString().c_str());
 	}
+	update_session_count();
+	if (client_window_on_granted && client_window_peer == addr) {
+		cancel_timeout("client_window_grant");
+		grant_client_window();
+	}
+	// A slot became available, help on-demand triggers to find us quickly
+	start_fast_advertising();
+}
+
+void
+SesameServerComponent::request_client_window(const NimBLEAddress& peer,
+                                             uint32_t duration_ms,
+                                             std::function<void()> on_granted) {
+	client_window_requests.push_back({peer, duration_ms, std::move(on_granted), millis()});
+	process_client_windows();
+}
+
+void
+SesameServerComponent::process_client_windows() {
+	if (client_window_peer || client_window_requests.empty()) {
+		return;
+	}
+	auto now = millis();
+	auto& req = client_window_requests.front();
+	// A command exchange of any session delays the window, as well as other activity of the peer
+	bool busy = last_command_ms && now - *last_command_ms < client_window_idle_ms;
+	if (auto* session = find_unlisted_session(req.peer); session && now - session->last_activity < client_window_idle_ms) {
+		busy = true;
+	}
+	if (busy && now - req.requested_ms < client_window_max_wait_ms) {
+		set_timeout("client_window", 250, [this]() { process_client_windows(); });
+		return;
+	}
+	if (busy) {
+		client_window_stats.forced++;
+	}
+	client_window_stats.granted++;
+	client_window_peer = req.peer;
+	client_window_on_granted = std::move(req.on_granted);
+	client_window_start_ms = now;
+	client_window_blocked.store(address_key(req.peer), std::memory_order_relaxed);
+	set_timeout("client_window", req.duration_ms, [this]() {
+		ESP_LOGW(TAG, "Client window for %s expired", client_window_peer->toString().c_str());
+		release_client_window();
+	});
+	client_window_requests.erase(client_window_requests.begin());
+	ESP_LOGI(TAG, "Client window for %s opened", client_window_peer->toString().c_str());
+	if (has_session(*client_window_peer)) {
+		disconnect(*client_window_peer);
+		// Fall back in case the disconnection is not reported
+		set_timeout("client_window_grant", 1000, [this]() { grant_client_window(); });
+	} else {
+		grant_client_window();
+	}
+}
+
+void
+SesameServerComponent::grant_client_window() {
+	if (auto on_granted = std::move(client_window_on_granted)) {
+		client_window_on_granted = nullptr;
+		on_granted();
+	}
+}
+
+void
+SesameServerComponent::release_client_window() {
+	if (!client_window_peer) {
+		return;
+	}
+	auto blackout = millis() - client_window_start_ms;
+	client_window_stats.last_blackout_ms = blackout;
+	client_window_stats.max_blackout_ms = std::max(client_window_stats.max_blackout_ms, blackout);
+	client_window_stats.total_blackout_ms += blackout;
+	ESP_LOGI(TAG, "Client window for %s closed after %" PRIu32 "ms", client_window_peer->toString().c_str(), blackout);
+	client_window_blocked.store(0, std::memory_order_relaxed);
+	client_window_peer.reset();
+	client_window_on_granted = nullptr;
+	cancel_timeout("client_window");
+	cancel_timeout("client_window_grant");
+	if (client_window_blackout_sensor) {
+		client_window_blackout_sensor->publish_state(blackout);
+	}
+	start_fast_advertising();
+	process_client_windows();
 }
 
 void
 SesameTrigger::update_connected(bool connected) {
+	this->connected = connected;
+	if (connected) {
+		connect_count++;
+	}
+	lock_state_delivery.reset();
 	if (connection_sensor) {
 		connection_sensor->publish_state(connected);
 	}
@@ -523,11 +1850,11 @@ SesameTrigger::update_connected(bool connected) {
 void
 SesameTrigger::notify_lock_state() {
 	if (lock_entity) {
-		if (!send_lock_state(lock_entity->get_state())) {
+		if (!send_lock_state(lock_entity->get_state(), true)) {
 			ESP_LOGW(TAG, "Failed to send lock state to %s", get_address().toString().c_str());
 		}
 	} else {
-		if (!server_component->send_current_lock_state(address)) {
+		if (!server_component->send_current_lock_state(address, true)) {
 			ESP_LOGW(TAG, "Failed to send lock state to %s", get_address().toString().c_str());
 		}
 	}
@@ -6,17 +6,37 @@
 #include <esphome/components/lock/lock.h>
 #include <esphome/components/sensor/sensor.h>
 #include <esphome/components/text_sensor/text_sensor.h>
+#include <esphome/core/automation.h>
 #include <esphome/core/component.h>
+#include <esphome/core/defines.h>
+#include <esphome/core/hal.h>
+#include <esphome/core/helpers.h>
 #include <esphome/core/preferences.h>
 #include <esphome/core/version.h>
+#include <atomic>
 #include <functional>
 #include <memory>
 #include <optional>
 #include <set>
 #include <span>
 #include <string_view>
+#include <utility>
 #include <variant>
 #include <vector>
+#ifdef USE_SESAME_SERVER_WORKER_TASK
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#endif
+#if defined(USE_SESAME_SERVER_AGGREGATE_EVENT) && defined(USE_API_HOMEASSISTANT_SERVICES)
+#define SESAME_SERVER_AGGREGATE_EVENT_API 1
+#include <esphome/components/api/custom_api_device.h>
+#endif
+#include "event_history_service.h"
+#include "event_queue.h"
+#include "latency_histogram.h"
+#include "tag_table.h"
+#include "trace_buffer.h"
+#include "trigger_logic.h"
 
 namespace esphome {
 namespace sesame_server {
@@ -30,37 +50,221 @@ class StatusLockWrapper {
 	StatusLockWrapper(lock::Lock& lock, SesameTrigger& trigger) : lock_(lock), parent_(trigger) { init(); }
 	StatusLockWrapper(lock::Lock& lock, SesameServerComponent& trigger) : lock_(lock), parent_(trigger) { init(); }
 	lock::LockState get_state() const { return lock_.state; }
+	bool send_if_pending();
 
  private:
 	void init();
+	bool send();
+	SesameServerComponent& server();
 	lock::Lock& lock_;
 	std::variant<std::reference_wrapper<SesameTrigger>, std::reference_wrapper<SesameServerComponent>> parent_;
+	// Lock state changed while coalescing, to be sent by SesameServerComponent::flush_lock_states()
+	bool pending_ = false;
+};
+
+// Stage durations of the last command, from the BLE callback to the event trigger.
+struct command_latency_t {
+	uint32_t queue_us;    // BLE callback -> dequeued in loop()
+	uint32_t publish_us;  // dequeued -> sensors published
+	uint32_t total_us;    // BLE callback -> trigger() called
+	uint32_t trigger_us;  // trigger() including on_event automations
+};
+
+enum class disconnect_reason_t : uint8_t { remote_terminated, local_terminated, timeout, failed_to_establish, other };
+constexpr size_t DISCONNECT_REASON_COUNT = static_cast<size_t>(disconnect_reason_t::other) + 1;
+
+// Connection parameters requested from a peer after authentication, `none` keeps the parameters chosen by the peer.
+enum class connection_profile_t : uint8_t { none, low_latency, balanced, low_power };
+constexpr size_t CONNECTION_PROFILE_COUNT = static_cast<size_t>(connection_profile_t::low_power) + 1;
+
+// Connection and session counters since boot.
+struct session_stats_t {
+	uint32_t connects;        // BLE connections evaluated by connect_check
+	uint32_t connect_denied;  // connections refused by connect_checks, trigger session reservation or a client window
+	uint32_t authentications;
+	uint32_t disconnects;
+	std::array<uint32_t, DISCONNECT_REASON_COUNT> disconnects_by_reason;
+	std::array<uint32_t, CONNECTION_PROFILE_COUNT> connection_profiles;  // connection parameter updates requested per profile
+	uint32_t connection_profile_failures;                                // peer connection not found
+	uint8_t sessions;  // currently authenticated sessions
+	uint8_t sessions_high_water;
+	uint8_t max_sessions;
+};
+
+// Last lock state delivered to a session, used to skip redundant sends, and the state waiting for redelivery.
+struct lock_state_delivery_t {
+	std::optional<lock::LockState> last_sent;
+	std::optional<lock::LockState> pending;  // only the latest failed state is kept, older ones are superseded
+	uint8_t attempts = 0;                    // failed sends of the pending state
+	uint32_t next_retry_ms = 0;
+	uint32_t first_failure_ms = 0;
+	void clear_pending() {
+		pending.reset();
+		attempts = 0;
+	}
+	void reset() {
+		last_sent.reset();
+		clear_pending();
+	}
+};
+
+// Main loop counters since boot, to compare the polling and event-driven loop modes.
+struct loop_stats_t {
+	uint32_t iterations;
+	uint32_t wakeups;  // loop re-enabled after it was disabled while idle
+	uint32_t sleeps;   // loop disabled while idle
+	uint64_t busy_us;  // time spent in loop()
+	uint32_t max_us;
+};
+
+// Client window counters since boot.
+struct client_window_stats_t {
+	uint32_t granted;
+	uint32_t forced;             // granted at the wait deadline while sessions were still busy
+	uint32_t last_blackout_ms;   // time the peer could not connect to the server
+	uint32_t max_blackout_ms;
+	uint32_t total_blackout_ms;
+};
+
+// Lock state redelivery counters since boot.
+struct lock_state_retry_stats_t {
+	uint32_t retries;             // redelivery attempts
+	uint32_t redelivered;         // states delivered after at least one failure
+	uint32_t superseded;          // pending states replaced by a newer state
+	uint32_t failures;            // states dropped after the last attempt failed
+	uint32_t last_redelivery_ms;  // time from the first failure to the delivery
+	uint32_t max_redelivery_ms;
+};
+
+constexpr size_t MAX_EXTRA_SIZE = 16;
+// History tags longer than this are truncated when received
+constexpr size_t MAX_TAG_SIZE = 64;
+// Events sent by one call of the event history service at most, to bound the API send buffer
+constexpr size_t EVENT_HISTORY_MAX_EVENTS_PER_CALL = 16;
+
+// Decoded extra payload sent with a command by Open Sensor / Open Sensor 2.
+// Byte 0 repeats the command, byte 1 is 0xff on Open Sensor or the switch position on Open Sensor 2.
+struct extra_info_t {
+	std::optional<libsesame3bt::Sesame::item_code_t> command;
+	std::optional<bool> switch_state;
+
+	static extra_info_t decode(std::span<const std::byte> extra);
+};
+
+// Values last published to the trigger sensors, before the sensor filters are applied.
+struct published_values_t {
+	float history_tag_type = NAN;
+	float scaled_voltage = NAN;
+	float scaled_voltage2 = NAN;
+	float battery_pct = NAN;
+	float battery_pct2 = NAN;
+	std::array<std::byte, MAX_EXTRA_SIZE> extra{};
+	uint8_t extra_len = 0;
+	std::optional<bool> switch_state;
 };
 
+// Optional per-trigger sensors, allocated only when at least one of them is configured.
+struct trigger_sensors_t {
+	text_sensor::TextSensor* history_tag = nullptr;
+	sensor::Sensor* history_tag_type = nullptr;
+	sensor::Sensor* scaled_voltage = nullptr;
+	sensor::Sensor* battery_pct = nullptr;
+	sensor::Sensor* scaled_voltage2 = nullptr;
+	sensor::Sensor* battery_pct2 = nullptr;
+	text_sensor::TextSensor* extra = nullptr;
+	binary_sensor::BinarySensor* switch_state = nullptr;
+#ifdef USE_SESAME_SERVER_PUBLISH_CHANGES_ONLY
+	published_values_t published;
+#endif
+};
+
+// Text forms of the last command returned by reference, allocated on the first call of an accessor
+// or when the history tag did not fit in the server's tag table.
+struct trigger_text_t {
+	std::string history_tag;
+	std::string extra;
+	bool history_tag_valid = false;
+	bool extra_valid = false;
+};
+
+class SesameRouteTrigger : public Trigger<std::string> {};
+
 class SesameServerComponent;
 class SesameTrigger : public event::Event {
  public:
-	SesameTrigger(SesameServerComponent* server_component, std::string_view addr, std::string_view uuid);
-	void set_history_tag_sensor(text_sensor::TextSensor* sensor) { history_tag_sensor.reset(sensor); }
-	void set_history_tag_type_sensor(sensor::Sensor* sensor) { history_tag_type_sensor.reset(sensor); }
-	void set_scaled_voltage_sensor(sensor::Sensor* sensor) { scaled_voltage_sensor.reset(sensor); }
-	void set_battery_pct_sensor(sensor::Sensor* sensor) { battery_pct_sensor.reset(sensor); }
-	void set_scaled_voltage2_sensor(sensor::Sensor* sensor) { scaled_voltage2_sensor.reset(sensor); }
-	void set_battery_pct2_sensor(sensor::Sensor* sensor) { battery_pct2_sensor.reset(sensor); }
-	void set_extra_sensor(text_sensor::TextSensor* sensor) { extra_sensor.reset(sensor); }
+	// `key` is the BLE address packed as in SesameServerConnectCheckEntry, resolved from btaddr or uuid by codegen
+	SesameTrigger(SesameServerComponent* server_component, uint64_t key);
+	void set_history_tag_sensor(text_sensor::TextSensor* sensor) { get_sensors().history_tag = sensor; }
+	void set_history_tag_type_sensor(sensor::Sensor* sensor) { get_sensors().history_tag_type = sensor; }
+	void set_scaled_voltage_sensor(sensor::Sensor* sensor) { get_sensors().scaled_voltage = sensor; }
+	void set_battery_pct_sensor(sensor::Sensor* sensor) { get_sensors().battery_pct = sensor; }
+	void set_scaled_voltage2_sensor(sensor::Sensor* sensor) { get_sensors().scaled_voltage2 = sensor; }
+	void set_battery_pct2_sensor(sensor::Sensor* sensor) { get_sensors().battery_pct2 = sensor; }
+	void set_extra_sensor(text_sensor::TextSensor* sensor) { get_sensors().extra = sensor; }
+	void set_switch_state_sensor(binary_sensor::BinarySensor* sensor) { get_sensors().switch_state = sensor; }
 	void set_lock_entity(lock::Lock* lock) { lock_entity = std::make_unique<StatusLockWrapper>(*lock, *this); }
+#ifdef USE_SESAME_SERVER_PUBLISH_CHANGES_ONLY
+	void set_publish_changes_only(bool changes_only) { publish_changes_only = changes_only; }
+	void set_voltage_deadband(float deadband) { voltage_deadband = deadband; }
+	void set_battery_pct_deadband(float deadband) { battery_pct_deadband = deadband; }
+#endif
+#ifdef USE_SESAME_SERVER_ROUTES
+	void add_route(uint32_t tag_hash,
+	               const char* tag,
+	               uint8_t event_mask,
+	               int16_t history_tag_type,
+	               SesameRouteTrigger* trigger);
+#endif
+#ifdef USE_SESAME_SERVER_DEDUP
+	void set_dedup_window(uint32_t ms) { dedup.set_window(ms); }
+	uint32_t get_suppressed_count() const { return dedup.get_suppressed_count(); }
+#else
+	uint32_t get_suppressed_count() const { return 0; }
+#endif
 	void set_connection_sensor(binary_sensor::BinarySensor* sensor) {
 		connection_sensor.reset(sensor);
 		connection_sensor->publish_state(false);
 	}
+#ifdef USE_SESAME_SERVER_AGGREGATE_EVENT
+	// Carry the values of each activation in one `esphome.sesame_server_trigger` event and publish the sensors
+	// only from SesameServerComponent's aggregate sensor interval. Without Home Assistant services of the API
+	// there is no event to carry them, and the sensors are published on each activation as usual.
+	void set_aggregate_event(bool aggregate) { aggregate_event = aggregate; }
+	bool is_aggregate_event() const { return aggregate_event; }
+#endif
+#ifdef SESAME_SERVER_AGGREGATE_EVENT_API
+	void flush_sensors();
+#endif
+	void set_connection_profile(connection_profile_t profile) { connection_profile = profile; }
+	connection_profile_t get_connection_profile() const { return connection_profile; }
 	const NimBLEAddress& get_address() const { return address; }
-	void invoke(libsesame3bt::Sesame::item_code_t cmd,
-	            const std::string& tag,
+	// Position in the server's triggers list, set by SesameServerComponent::add_trigger()
+	void set_index(uint8_t index) { this->index = index; }
+	uint8_t get_index() const { return index; }
+	bool invoke(libsesame3bt::Sesame::item_code_t cmd,
+	            std::string_view tag,
 	            std::optional<libsesame3bt::history_tag_type_t> history_tag_type,
 	            float scaled_voltage,
 	            float scaled_voltage2,
-	            std::string_view extra);
-	const std::string& get_history_tag() const { return history_tag; }
+	            std::string_view extra,
+	            uint32_t received_us,
+	            uint32_t dequeued_us);
+	bool invoke(libsesame3bt::Sesame::item_code_t cmd,
+	            std::string_view tag,
+	            std::optional<libsesame3bt::history_tag_type_t> history_tag_type,
+	            float scaled_voltage,
+	            float scaled_voltage2,
+	            std::string_view extra) {
+		auto now = micros();
+		return invoke(cmd, tag, history_tag_type, scaled_voltage, scaled_voltage2, extra, now, now);
+	}
+#ifdef USE_SESAME_SERVER_TRIGGER_LATENCY
+	const LatencyHistogram& get_latency_histogram() const { return latency_histogram; }
+	const command_latency_t& get_last_latency() const { return last_latency; }
+#endif
+	const std::string& get_history_tag() const;
+	tag_id_t get_history_tag_id() const { return history_tag_id; }
+	std::optional<tag_uuid_t> get_history_tag_uuid() const;
 	[[deprecated("Use get_history_tag_type() instead")]]
 	float get_trigger_type() const {
 		return history_tag_type;
@@ -70,40 +274,162 @@ class SesameTrigger : public event::Event {
 	float get_battery_pct() const { return battery_pct; }
 	float get_scaled_voltage2() const { return scaled_voltage2; }
 	float get_battery_pct2() const { return battery_pct2; }
-	const std::string& get_extra() const { return extra; }
-	bool send_lock_state(lock::LockState state);
+	const std::string& get_extra() const;
+	std::span<const std::byte> get_extra_bytes() const { return {extra.data(), extra_len}; }
+	extra_info_t get_extra_info() const { return extra_info_t::decode(get_extra_bytes()); }
+	bool send_lock_state(lock::LockState state, bool force = false);
 	void update_connected(bool connected);
+	bool is_connected() const { return connected; }
+	uint32_t get_connect_count() const { return connect_count; }
 	bool has_lock_entity() const { return lock_entity != nullptr; }
+	bool has_sensors() const { return sensors != nullptr; }
 	void notify_lock_state();
+	void flush_lock_state();
+	SesameServerComponent& get_server_component() const { return *server_component; }
+	lock_state_delivery_t& get_lock_state_delivery() { return lock_state_delivery; }
 
  private:
+	trigger_sensors_t& get_sensors();
+	trigger_text_t& get_text() const;
+	void publish_sensors(std::string_view tag, bool tag_changed);
+#ifdef USE_SESAME_SERVER_DEDUP
+	bool is_duplicate(libsesame3bt::Sesame::item_code_t cmd, std::string_view tag, uint32_t received_us);
+#endif
+#ifdef SESAME_SERVER_AGGREGATE_EVENT_API
+	void fire_aggregate_event(const char* event_type);
+#endif
+#ifdef USE_SESAME_SERVER_ROUTES
+	void dispatch_routes(libsesame3bt::Sesame::item_code_t cmd,
+	                     std::string_view tag,
+	                     std::optional<libsesame3bt::history_tag_type_t> history_tag_type,
+	                     const char* event_type);
+#endif
+
 	NimBLEAddress address;
 	SesameServerComponent* server_component;
-	std::unique_ptr<text_sensor::TextSensor> history_tag_sensor;
-	std::unique_ptr<sensor::Sensor> history_tag_type_sensor;
+	std::unique_ptr<trigger_sensors_t> sensors;
 	std::unique_ptr<binary_sensor::BinarySensor> connection_sensor;
 	std::unique_ptr<StatusLockWrapper> lock_entity;
-	std::unique_ptr<sensor::Sensor> scaled_voltage_sensor;
-	std::unique_ptr<sensor::Sensor> battery_pct_sensor;
-	std::unique_ptr<sensor::Sensor> scaled_voltage2_sensor;
-	std::unique_ptr<sensor::Sensor> battery_pct2_sensor;
-	std::unique_ptr<text_sensor::TextSensor> extra_sensor;
-
-	std::string history_tag;
+	mutable std::unique_ptr<trigger_text_t> text;
+	tag_id_t history_tag_id = TagTable::NO_TAG;
+	std::array<std::byte, MAX_EXTRA_SIZE> extra{};
+	uint8_t extra_len = 0;
 	float history_tag_type = NAN;
 	float scaled_voltage = NAN;
 	float scaled_voltage2 = NAN;
 	float battery_pct = NAN;
 	float battery_pct2 = NAN;
-	std::string extra;
+	uint32_t connect_count = 0;
+#ifdef USE_SESAME_SERVER_TRIGGER_LATENCY
+	command_latency_t last_latency{};
+	LatencyHistogram latency_histogram;
+#endif
+#ifdef USE_SESAME_SERVER_DEDUP
+	DedupFilter dedup;
+#endif
+#ifdef USE_SESAME_SERVER_ROUTES
+	RouteTable<SesameRouteTrigger*> routes;
+#endif
+#ifdef USE_SESAME_SERVER_PUBLISH_CHANGES_ONLY
+	// Publish sensors only when the value differs from the published state (beyond the deadband for voltages/percentages)
+	float voltage_deadband = 0.0f;
+	float battery_pct_deadband = 0.0f;
+	bool publish_changes_only = false;
+#endif
+#ifdef USE_SESAME_SERVER_AGGREGATE_EVENT
+	bool aggregate_event = false;
+#endif
+#ifdef SESAME_SERVER_AGGREGATE_EVENT_API
+	bool sensors_pending = false;  // received values not published to the sensors yet
+	bool pending_tag_changed = false;
+#endif
+	lock_state_delivery_t lock_state_delivery;
+	connection_profile_t connection_profile = connection_profile_t::none;
+	uint8_t index = 0;
+	bool connected = false;
 #if ESPHOME_VERSION_CODE < VERSION_CODE(2025, 11, 0)
 	static inline const std::set<std::string> supported_triggers{"open", "close", "lock", "unlock"};
 #endif
 };
 
+enum class trace_event_t : uint8_t { connect, disconnect, command, lock_state };
+
+// Compact record of a server event, captured when trace is enabled and printed by SesameServerComponent::dump_trace().
+struct trace_record_t {
+	uint64_t address;  // packed type and address of the peer
+	uint32_t time_us;
+	float scaled_voltage;
+	float scaled_voltage2;
+	trace_event_t event;
+	uint8_t code;              // command: item code, lock_state: lock::LockState
+	uint8_t history_tag_type;  // 0xff when not sent
+	uint8_t extra_len;
+	uint8_t tag_len;
+	int16_t result;  // disconnect: reason, lock_state: 1 when sent
+	std::array<std::byte, MAX_EXTRA_SIZE> extra;
+	// Kept inline rather than in the tag table, so that tags of unlisted devices and first commands are recorded too
+	std::array<char, MAX_TAG_SIZE> tag;
+
+	std::string_view get_tag() const { return {tag.data(), tag_len}; }
+};
+
+// Event fired by a trigger, kept in the event history so that clients can catch up after an outage.
+struct event_record_t {
+	uint32_t seq;
+	uint32_t time_ms;  // millis() when the command was received
+	float scaled_voltage;
+	float scaled_voltage2;
+	uint8_t trigger_index;     // position in the triggers list
+	uint8_t item_code;
+	uint8_t history_tag_type;  // 0xff when not sent
+	uint8_t tag_len;
+	// Kept inline rather than in the tag table, which stops taking new tags when full
+	std::array<char, MAX_TAG_SIZE> tag;
+
+	std::string_view get_tag() const { return {tag.data(), tag_len}; }
+};
+
+#ifndef SESAME_SERVER_TAG_TABLE_SIZE
+#define SESAME_SERVER_TAG_TABLE_SIZE 32
+#endif
+
+#ifndef SESAME_SERVER_COMMAND_QUEUE_SIZE
+#define SESAME_SERVER_COMMAND_QUEUE_SIZE 8
+#endif
+
+// Command received from a trigger device, copied out of the BLE callback for processing in loop().
+struct command_event_t {
+	static constexpr size_t TAG_CAPACITY = MAX_TAG_SIZE;
+	static constexpr size_t EXTRA_CAPACITY = MAX_EXTRA_SIZE;
+
+	NimBLEAddress address;
+	libsesame3bt::Sesame::item_code_t item_code;
+	std::optional<libsesame3bt::history_tag_type_t> history_tag_type;
+	uint8_t tag_len;
+	uint8_t extra_len;
+	float scaled_voltage;
+	float scaled_voltage2;
+	uint32_t received_us;
+	char tag[TAG_CAPACITY];
+	std::byte extra[EXTRA_CAPACITY];
+
+	std::string_view get_tag() const { return {tag, tag_len}; }
+	std::string_view get_extra() const { return {reinterpret_cast<const char*>(extra), extra_len}; }
+};
+
+enum class advertising_mode_t : uint8_t { fast, slow, paused };
+
+#ifdef USE_SESAME_SERVER_WORKER_TASK
+using server_mutex_t = Mutex;
+#else
+// sesame_server is used from the main loop task only
+struct server_mutex_t {};
+#endif
+
 enum class connect_check_policy_t : uint8_t { deny, allow };
 struct SesameServerConnectCheckEntry {
-	NimBLEAddress address;
+	// BLE address packed as (type << 48) | address, MSB first
+	uint64_t address;
 	connect_check_policy_t policy;
 };
 
@@ -112,49 +438,329 @@ class SesameServerComponent : public Component {
 	SesameServerComponent(uint8_t max_sessions, std::string_view uuid);
 	void setup() override;
 	void loop() override;
+	void dump_config() override;
 	void reset();
-	void add_trigger(SesameTrigger* trigger) {
-		auto p = std::unique_ptr<SesameTrigger>(trigger);
-		triggers.push_back(std::move(p));
+	void add_trigger(SesameTrigger* trigger);
+	// Address key codegen derived from a trigger uuid, checked against the library in setup()
+	void add_uuid_check(uint64_t key, const char* uuid) { uuid_checks.push_back({key, uuid}); }
+	virtual float get_setup_priority() const override {
+		return early_start ? setup_priority::BLUETOOTH : setup_priority::AFTER_WIFI;
+	};
+	// Start BLE before WiFi and hold received commands until the API is connected or the timeout elapses
+	void set_early_start(uint32_t hold_timeout_ms) {
+		early_start = true;
+		event_hold_timeout_ms = hold_timeout_ms;
+	}
+	bool is_holding_events() const { return holding_events; }
+	// True while loop() delivers the commands held by early_start, their latency is not recorded
+	bool is_delivering_held_command() const { return held_commands > 0; }
+#ifdef USE_SESAME_SERVER_EVENT_DRIVEN_LOOP
+	// Pump the BLE server only while there are sessions or pending work, and disable loop() otherwise
+	void set_event_driven_loop(bool enabled) { event_driven_loop = enabled; }
+#endif
+	const loop_stats_t& get_loop_stats() const { return loop_stats; }
+#ifdef USE_SESAME_SERVER_AGGREGATE_EVENT
+	void set_aggregate_sensor_interval(uint32_t ms) { aggregate_sensor_interval_ms = ms; }
+#endif
+#ifdef SESAME_SERVER_AGGREGATE_EVENT_API
+	// Sends the `esphome.sesame_server_trigger` events of aggregate_event triggers, nullptr before setup()
+	api::CustomAPIDevice* get_aggregate_event_api() const { return aggregate_event_api.get(); }
+#endif
+#ifdef USE_SESAME_SERVER_WORKER_TASK
+	// Pump the BLE server on a dedicated task pinned to `core` instead of loop()
+	void set_worker_task(uint8_t core, uint8_t priority, uint32_t stack_size, uint32_t interval_ms) {
+		worker_core = core;
+		worker_priority = priority;
+		worker_stack_size = stack_size;
+		worker_interval_ms = interval_ms;
 	}
-	virtual float get_setup_priority() const override { return setup_priority::AFTER_WIFI; };
+	uint32_t get_worker_iterations() const { return worker_iterations.load(std::memory_order_relaxed); }
+#endif
+	// Lend a time window to a BLE client (dual-role) for connecting to `peer`. The window is granted when no session, `peer` or
+	// another one, sent a command for the idle time (or after the maximum wait), only `peer` is disconnected and kept from
+	// reconnecting, and `on_granted` is called once its session is closed. The window ends with release_client_window() or
+	// after duration_ms.
+	void request_client_window(const NimBLEAddress& peer, uint32_t duration_ms, std::function<void()> on_granted);
+	void release_client_window();
+	bool is_client_window_active() const { return client_window_peer.has_value(); }
+	void set_client_window_timing(uint32_t idle_ms, uint32_t max_wait_ms) {
+		client_window_idle_ms = idle_ms;
+		client_window_max_wait_ms = max_wait_ms;
+	}
+	void set_client_window_blackout_sensor(sensor::Sensor* sensor) { client_window_blackout_sensor = sensor; }
+	const client_window_stats_t& get_client_window_stats() const { return client_window_stats; }
 	void disconnect(const NimBLEAddress& addr);
 	bool has_session(const NimBLEAddress& addr) const;
 	bool has_trigger(const NimBLEAddress& addr) const;
 	void start_advertising();
 	void stop_advertising();
+	void set_advertising_profile(uint32_t fast_interval_ms,
+	                             uint32_t fast_duration_ms,
+	                             uint32_t slow_interval_ms,
+	                             bool pause_when_full) {
+		advertising_scheduler = true;
+		fast_advertising_interval_ms = fast_interval_ms;
+		fast_advertising_duration_ms = fast_duration_ms;
+		slow_advertising_interval_ms = slow_interval_ms;
+		pause_advertising_when_full = pause_when_full;
+	}
+	void start_fast_advertising();
+	advertising_mode_t get_advertising_mode() const { return advertising_mode; }
 	void set_lock_entity(lock::Lock* lock) { lock_entity = std::make_unique<StatusLockWrapper>(*lock, *this); }
 	bool send_lock_state(lock::LockState state);
-	bool send_lock_state(const NimBLEAddress* dest, lock::LockState state);
-	bool send_current_lock_state(const NimBLEAddress& address);
+	bool send_lock_state(const NimBLEAddress* dest, lock::LockState state, bool force = false);
+	bool send_current_lock_state(const NimBLEAddress& address, bool force = false);
 	void notify_lock_state();
-	void set_connect_checks(const std::span<const SesameServerConnectCheckEntry> entries) { connect_checks = entries; }
+	void set_lock_state_coalesce(uint32_t ms) { lock_state_coalesce_ms = ms; }
+	uint32_t get_lock_state_coalesce() const { return lock_state_coalesce_ms; }
+	void schedule_lock_state_flush();
+	void set_lock_state_retry(uint8_t max_attempts, uint32_t initial_backoff_ms, uint32_t max_backoff_ms) {
+		lock_state_retry_max_attempts = max_attempts;
+		lock_state_retry_initial_ms = initial_backoff_ms;
+		lock_state_retry_max_ms = max_backoff_ms;
+	}
+	const lock_state_retry_stats_t& get_lock_state_retry_stats() const { return lock_state_retry_stats; }
+#ifdef USE_SESAME_SERVER_EVENT_HISTORY
+	void set_event_history_size(size_t records) { event_history_size = records; }
+	const TraceBuffer<event_record_t>& get_event_history() const { return event_history; }
+	uint32_t get_event_history_seq() const { return event_history_seq; }
+#ifdef SESAME_SERVER_EVENT_HISTORY_SERVICE
+	// Sends up to `max_count` events newer than `since`, returns the seq of the last event sent (`since` if none)
+	uint32_t send_event_history(uint32_t since, size_t max_count);
+#endif
+	SesameTrigger* get_trigger(size_t index) const { return index < triggers.size() ? triggers[index].get() : nullptr; }
+#endif
+#ifdef USE_SESAME_SERVER_TRACE
+	void set_trace_size(size_t records) { trace_size = records; }
+	const TraceBuffer<trace_record_t>& get_trace() const { return trace_buffer; }
+	void dump_trace();
+	void clear_trace() { trace_buffer.clear(); }
+#endif
+	uint32_t get_lock_state_skipped_count() const { return lock_state_skipped_count; }
+	void set_connect_checks(const std::span<const SesameServerConnectCheckEntry> entries, connect_check_policy_t default_policy) {
+		connect_checks = entries;
+		connect_check_default = default_policy;
+	}
+	void set_connect_checks(connect_check_policy_t default_policy) { connect_check_default = default_policy; }
+	uint32_t get_connect_allowed_count() const { return connect_allowed_count.load(std::memory_order_relaxed); }
+	uint32_t get_connect_denied_count() const { return connect_denied_count.load(std::memory_order_relaxed); }
 	void set_version_tag(std::string_view tag) { sesame_server.set_version_tag(tag); }
+	uint32_t get_command_overflow_count() const { return command_overflow_count.load(std::memory_order_relaxed); }
+	TagTable& get_tag_table() { return tag_table; }
+	tag_id_t find_tag_id(std::string_view tag) const { return tag_table.find(tag); }
+	// Called by triggers with the time from the BLE callback to the event trigger
+#ifdef USE_SESAME_SERVER_LATENCY_SENSORS
+	void record_command_latency(uint32_t total_us) { latency_window.record(total_us); }
+	void set_latency_p50_sensor(sensor::Sensor* sensor) { latency_p50_sensor = sensor; }
+	void set_latency_p99_sensor(sensor::Sensor* sensor) { latency_p99_sensor = sensor; }
+	void set_latency_max_sensor(sensor::Sensor* sensor) { latency_max_sensor = sensor; }
+#else
+	void record_command_latency(uint32_t) {}
+#endif
+	void set_diagnostics_interval(uint32_t ms) { diagnostics_interval_ms = ms; }
+	void set_session_count_sensor(sensor::Sensor* sensor) { session_count_sensor = sensor; }
+	void set_session_high_water_sensor(sensor::Sensor* sensor) { session_high_water_sensor = sensor; }
+	void set_authentication_count_sensor(sensor::Sensor* sensor) { authentication_count_sensor = sensor; }
+	void set_disconnect_count_sensor(sensor::Sensor* sensor) { disconnect_count_sensor = sensor; }
+	void set_connect_denied_count_sensor(sensor::Sensor* sensor) { connect_denied_count_sensor = sensor; }
+	void set_lock_state_retry_count_sensor(sensor::Sensor* sensor) { lock_state_retry_count_sensor = sensor; }
+	void set_lock_state_failure_count_sensor(sensor::Sensor* sensor) { lock_state_failure_count_sensor = sensor; }
+	void set_loop_wakeup_count_sensor(sensor::Sensor* sensor) { loop_wakeup_count_sensor = sensor; }
+	void set_loop_time_sensor(sensor::Sensor* sensor) { loop_time_sensor = sensor; }
+	session_stats_t get_session_stats() const;
+#ifdef USE_SESAME_SERVER_TRIGGER_LATENCY
+	// Latency histograms of all triggers merged
+	LatencyHistogram get_latency_histogram() const;
+#endif
+	void set_unlisted_idle_timeout(uint32_t ms) { unlisted_idle_timeout_ms = ms; }
+	void set_unlisted_eviction_idle(uint32_t ms) { unlisted_eviction_idle_ms = ms; }
+	void set_unlisted_connection_profile(connection_profile_t profile) { unlisted_connection_profile = profile; }
+	void set_reserved_trigger_sessions(uint8_t sessions) { reserved_trigger_sessions = sessions; }
 
  private:
 	libsesame3bt::SesameServer sesame_server;
 	const NimBLEUUID uuid;
+	// Sorted by packed BLE address by codegen, searched when dispatching commands and connection events.
 	std::vector<std::unique_ptr<SesameTrigger>> triggers;
+	bool unsorted_triggers = false;
+	struct uuid_check_t {
+		uint64_t key;
+		const char* uuid;
+	};
+	std::vector<uuid_check_t> uuid_checks;  // emptied by setup()
 	// Authenticated sessions that are not explicitly configured as triggers.
 	// These include, for example, the official SESAME app whose BLE address may change.
-	std::vector<NimBLEAddress> unlisted_sessions;
+	struct unlisted_session_t {
+		NimBLEAddress address;
+		lock_state_delivery_t lock_state_delivery;
+		uint32_t last_activity;  // millis() of connection, command or lock state delivery
+	};
+	std::vector<unlisted_session_t> unlisted_sessions;
 	ESPPreferenceObject prefs_secret;
 	std::unique_ptr<StatusLockWrapper> lock_entity;
 	bool server_started = false;
+	struct client_window_request_t {
+		NimBLEAddress peer;
+		uint32_t duration_ms;
+		std::function<void()> on_granted;
+		uint32_t requested_ms;
+	};
+	std::vector<client_window_request_t> client_window_requests;
+	std::optional<uint32_t> last_command_ms;  // millis() when the last command of any session was received
+	std::optional<NimBLEAddress> client_window_peer;
+	std::function<void()> client_window_on_granted;  // waiting for the peer's session to close
+	uint32_t client_window_start_ms = 0;
+	// address_key() of the peer refused by connect_check during the window, 0 if none
+	std::atomic<uint64_t> client_window_blocked{0};
+	uint32_t client_window_idle_ms = 2000;
+	uint32_t client_window_max_wait_ms = 30000;
+	client_window_stats_t client_window_stats{};
+	sensor::Sensor* client_window_blackout_sensor = nullptr;
+	bool early_start = false;
+	bool holding_events = false;
+	uint32_t event_hold_timeout_ms = 0;
+	size_t held_commands = 0;  // left to deliver of those queued when holding ended
+	uint32_t lock_state_coalesce_ms = 0;
+	bool lock_state_flush_scheduled = false;
+	uint32_t lock_state_skipped_count = 0;
+	// Failed lock state deliveries are retried with exponential backoff, 0 attempts disables retrying
+	uint8_t lock_state_retry_max_attempts = 5;
+	uint32_t lock_state_retry_initial_ms = 250;
+	uint32_t lock_state_retry_max_ms = 5000;
+	lock_state_retry_stats_t lock_state_retry_stats{};
+#ifdef USE_SESAME_SERVER_EVENT_HISTORY
+	size_t event_history_size = 0;
+	uint32_t event_history_seq = 0;
+	TraceBuffer<event_record_t> event_history;
+	void record_event(const SesameTrigger& trigger, const command_event_t& ev);
+#ifdef SESAME_SERVER_EVENT_HISTORY_SERVICE
+	std::unique_ptr<EventHistoryService> event_history_service;
+#endif
+#endif
+#ifdef USE_SESAME_SERVER_TRACE
+	size_t trace_size = 0;
+	TraceBuffer<trace_record_t> trace_buffer;
+#endif
+	// Serializes sesame_server calls from loop() and timers with the worker task, empty without it
+	[[no_unique_address]] mutable server_mutex_t sesame_server_mutex;
+#ifdef USE_SESAME_SERVER_WORKER_TASK
+	TaskHandle_t worker_handle = nullptr;
+	uint8_t worker_core = 1;
+	uint8_t worker_priority = 5;
+	uint32_t worker_stack_size = 8192;
+	uint32_t worker_interval_ms = 10;
+	std::atomic<uint32_t> worker_iterations{0};
+	bool start_worker_task();
+	static void worker_task(void* arg);
+#endif
+	// Filled by the command callback on the NimBLE host task, its only producer, and drained by loop()
+	EventQueue<command_event_t, SESAME_SERVER_COMMAND_QUEUE_SIZE> command_queue;
+	std::atomic<uint32_t> command_overflow_count{0};
+	// History tags received from triggers, accessed from loop() only
+	TagTable tag_table{SESAME_SERVER_TAG_TABLE_SIZE};
+#ifdef USE_SESAME_SERVER_LATENCY_SENSORS
+	// Latencies of commands since the last diagnostics publication
+	LatencyHistogram latency_window;
+	sensor::Sensor* latency_p50_sensor = nullptr;
+	sensor::Sensor* latency_p99_sensor = nullptr;
+	sensor::Sensor* latency_max_sensor = nullptr;
+#endif
+	uint32_t diagnostics_interval_ms = 60 * 1000;
+	session_stats_t session_stats{};
+	sensor::Sensor* session_count_sensor = nullptr;
+	sensor::Sensor* session_high_water_sensor = nullptr;
+	sensor::Sensor* authentication_count_sensor = nullptr;
+	sensor::Sensor* disconnect_count_sensor = nullptr;
+	sensor::Sensor* connect_denied_count_sensor = nullptr;
+	sensor::Sensor* lock_state_retry_count_sensor = nullptr;
+	sensor::Sensor* lock_state_failure_count_sensor = nullptr;
+	sensor::Sensor* loop_wakeup_count_sensor = nullptr;
+	sensor::Sensor* loop_time_sensor = nullptr;
+	loop_stats_t loop_stats{};
+#ifdef USE_SESAME_SERVER_AGGREGATE_EVENT
+	uint32_t aggregate_sensor_interval_ms = 60 * 1000;
+#endif
+#ifdef SESAME_SERVER_AGGREGATE_EVENT_API
+	std::unique_ptr<api::CustomAPIDevice> aggregate_event_api;
+#endif
+#ifdef USE_SESAME_SERVER_EVENT_DRIVEN_LOOP
+	bool event_driven_loop = false;
+	bool loop_enabled = true;
+	// A connection was accepted and its session is not authenticated yet
+	bool handshake_pending = false;
+	uint32_t handshake_start_ms = 0;
+	uint32_t seen_connect_allowed_count = 0;
+	HighFrequencyLoopRequester high_frequency_loop;
+	void update_loop_state();
+#endif
+	// Sorted by address, without the final 'any' entry which is held in connect_check_default.
 	std::span<const SesameServerConnectCheckEntry> connect_checks{};
+	std::optional<connect_check_policy_t> connect_check_default;
+	// connect_check() runs on the NimBLE host task
+	std::atomic<uint32_t> connect_allowed_count{0};
+	std::atomic<uint32_t> connect_denied_count{0};
+	// Session admission, evaluated on the NimBLE host task
+	uint8_t reserved_trigger_sessions = 0;
+	uint32_t unlisted_idle_timeout_ms = 0;
+	// Unlisted sessions active more recently are not evicted for a connecting trigger
+	uint32_t unlisted_eviction_idle_ms = 5 * 1000;
+	connection_profile_t unlisted_connection_profile = connection_profile_t::none;
+	std::atomic<uint8_t> active_sessions{0};
+	std::atomic<uint8_t> unlisted_session_count{0};
+	std::atomic<bool> eviction_requested{false};
+	// Advertising scheduler
+	bool advertising_scheduler = false;
+	bool advertising_stopped = false;  // stop_advertising() called explicitly
+	bool pause_advertising_when_full = true;
+	advertising_mode_t advertising_mode = advertising_mode_t::fast;
+	uint32_t fast_advertising_interval_ms = 0;
+	uint32_t fast_advertising_duration_ms = 0;
+	uint32_t slow_advertising_interval_ms = 0;
 
+	bool check_uuid_addresses();
 	bool prepare_secret();
 	bool save_secret(const std::array<std::byte, libsesame3bt::Sesame::SECRET_SIZE>& secret);
-	void on_command(const NimBLEAddress& addr,
-	                libsesame3bt::Sesame::item_code_t cmd,
-	                const std::string tag,
-	                std::optional<libsesame3bt::history_tag_type_t> history_tag_type,
-	                float scaled_voltage,
-	                float scaled_voltage2,
-	                std::string_view extra);
+	libsesame3bt::Sesame::result_code_t enqueue_command(const NimBLEAddress& addr,
+	                                                    libsesame3bt::Sesame::item_code_t cmd,
+	                                                    std::string_view tag,
+	                                                    std::optional<libsesame3bt::history_tag_type_t> history_tag_type,
+	                                                    float scaled_voltage,
+	                                                    float scaled_voltage2,
+	                                                    std::string_view extra);
+	void on_command(const command_event_t& ev);
 	void on_connected(const NimBLEAddress& addr);
 	void on_disconnect(const NimBLEAddress& addr, int reason);
 	bool connect_check(const NimBLEAddress& addr);
+	bool check_connect_policy(const NimBLEAddress& addr);
+	bool check_admission(const NimBLEAddress& addr);
+	void evict_unlisted_sessions(bool lru);
+	unlisted_session_t* find_unlisted_session(const NimBLEAddress& addr);
+	SesameTrigger* find_trigger(const NimBLEAddress& addr) const;
+	lock_state_delivery_t* find_lock_state_delivery(const NimBLEAddress& addr);
+	bool deliver_lock_state(const NimBLEAddress& addr,
+	                        lock_state_delivery_t& delivery,
+	                        const libsesame3bt::Sesame::mecha_status_5_t& status,
+	                        lock::LockState state,
+	                        bool force);
+	void flush_lock_states();
+	void schedule_lock_state_retry(const NimBLEAddress& addr, lock_state_delivery_t& delivery, lock::LockState state);
+	void arm_lock_state_retry();
+	void retry_lock_states();
+	void release_events(const char* reason);
+	void process_client_windows();
+	void grant_client_window();
+#ifdef USE_SESAME_SERVER_TRACE
+	trace_record_t* trace(trace_event_t event, const NimBLEAddress& addr);
+#endif
+	void publish_diagnostics();
+	bool has_diagnostic_sensors() const;
+	void update_session_count();
+	void wake_loop();
+	void apply_connection_profile(const NimBLEAddress& addr, connection_profile_t profile);
+	bool is_full() const;
+	void set_advertising_mode(advertising_mode_t mode);
+	bool apply_advertising_interval(uint32_t interval_ms);
+	void schedule_advertising();
 };
 
 }  // namespace sesame_server
@@ -0,0 +1,147 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <variant>
+#include <vector>
+#include "trigger_logic.h"
+
+namespace esphome::sesame_server {
+
+using tag_id_t = uint16_t;
+using tag_uuid_t = std::array<std::byte, 16>;
+
+// Interned history tags. Each distinct tag is stored once and identified by a small id that stays valid until reboot.
+// Tags in canonical lowercase UUID form (8-4-4-4-12) are kept as 16 bytes, other tags (names) as strings.
+// Id 0 (NO_TAG) stands for the empty tag and for tags that did not fit in the table.
+class TagTable {
+ public:
+	static constexpr tag_id_t NO_TAG = 0;
+	static constexpr size_t UUID_STRING_LENGTH = 36;
+
+	explicit TagTable(size_t capacity) : capacity(capacity) {}
+
+	// Id of the tag, adding it to the table if not known yet.
+	tag_id_t intern(std::string_view tag) {
+		if (tag.empty()) {
+			return NO_TAG;
+		}
+		auto hash = fnv1a_hash(tag);
+		if (auto id = find(tag, hash); id != NO_TAG) {
+			return id;
+		}
+		if (entries.size() >= capacity) {
+			return NO_TAG;
+		}
+		if (auto uuid = parse_uuid(tag)) {
+			entries.emplace_back(*uuid);
+		} else {
+			entries.emplace_back(std::string{tag});
+		}
+		hashes.push_back(hash);
+		return static_cast<tag_id_t>(entries.size());
+	}
+	// Id of the tag if it is already in the table, NO_TAG otherwise.
+	tag_id_t find(std::string_view tag) const { return tag.empty() ? NO_TAG : find(tag, fnv1a_hash(tag)); }
+	std::string to_string(tag_id_t id) const {
+		if (id == NO_TAG || id > entries.size()) {
+			return {};
+		}
+		const auto& entry = entries[id - 1];
+		if (auto uuid = std::get_if<tag_uuid_t>(&entry)) {
+			return format_uuid(*uuid);
+		}
+		return std::get<std::string>(entry);
+	}
+	// Binary UUID of the tag, if it is a UUID.
+	std::optional<tag_uuid_t> get_uuid(tag_id_t id) const {
+		if (id == NO_TAG || id > entries.size()) {
+			return std::nullopt;
+		}
+		if (auto uuid = std::get_if<tag_uuid_t>(&entries[id - 1])) {
+			return *uuid;
+		}
+		return std::nullopt;
+	}
+	size_t size() const { return entries.size(); }
+	bool full() const { return entries.size() >= capacity; }
+
+	static std::optional<tag_uuid_t> parse_uuid(std::string_view str) {
+		if (str.size() != UUID_STRING_LENGTH) {
+			return std::nullopt;
+		}
+		tag_uuid_t uuid;
+		size_t pos = 0;
+		for (size_t i = 0; i < uuid.size(); i++) {
+			if (pos == 8 || pos == 13 || pos == 18 || pos == 23) {
+				if (str[pos] != '-') {
+					return std::nullopt;
+				}
+				pos++;
+			}
+			int hi = hex_value(str[pos]);
+			int lo = hex_value(str[pos + 1]);
+			if (hi < 0 || lo < 0) {
+				return std::nullopt;
+			}
+			uuid[i] = static_cast<std::byte>(hi << 4 | lo);
+			pos += 2;
+		}
+		return uuid;
+	}
+	static std::string format_uuid(const tag_uuid_t& uuid) {
+		static constexpr char digits[] = "0123456789abcdef";
+		std::string str;
+		str.reserve(UUID_STRING_LENGTH);
+		for (size_t i = 0; i < uuid.size(); i++) {
+			if (i == 4 || i == 6 || i == 8 || i == 10) {
+				str.push_back('-');
+			}
+			auto b = std::to_integer<uint8_t>(uuid[i]);
+			str.push_back(digits[b >> 4]);
+			str.push_back(digits[b & 0x0f]);
+		}
+		return str;
+	}
+
+ private:
+	// Only lowercase digits are accepted so that to_string() gives back the received text.
+	static int hex_value(char c) {
+		if (c >= '0' && c <= '9') {
+			return c - '0';
+		}
+		if (c >= 'a' && c <= 'f') {
+			return c - 'a' + 10;
+		}
+		return -1;
+	}
+	// Entries are compared only when the hash of their text matches
+	tag_id_t find(std::string_view tag, uint32_t hash) const {
+		for (size_t i = 0; i < hashes.size(); i++) {
+			if (hashes[i] != hash) {
+				continue;
+			}
+			const auto& entry = entries[i];
+			bool match;
+			if (auto uuid = std::get_if<tag_uuid_t>(&entry)) {
+				auto parsed = parse_uuid(tag);
+				match = parsed && *parsed == *uuid;
+			} else {
+				match = std::get<std::string>(entry) == tag;
+			}
+			if (match) {
+				return static_cast<tag_id_t>(i + 1);
+			}
+		}
+		return NO_TAG;
+	}
+
+	std::vector<std::variant<std::string, tag_uuid_t>> entries;
+	std::vector<uint32_t> hashes;  // fnv1a_hash() of the tag text, parallel to entries
+	size_t capacity;
+};
+
+}  // namespace esphome::sesame_server
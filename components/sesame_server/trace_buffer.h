@@ -0,0 +1,56 @@
+#pragma once
+#include <esphome/core/helpers.h>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+namespace esphome::sesame_server {
+
+// Fixed capacity ring of records, overwriting the oldest one when full. Used from one task only.
+// The storage is allocated once and placed in PSRAM when available.
+template <typename T>
+class TraceBuffer {
+	static_assert(std::is_trivially_copyable_v<T>, "TraceBuffer records must be trivially copyable");
+
+ public:
+	void allocate(size_t capacity) {
+		RAMAllocator<T> allocator;
+		records = allocator.allocate(capacity);
+		this->capacity = records ? capacity : 0;
+		clear();
+	}
+	// Slot for a new record, nullptr if not allocated.
+	T* push() {
+		if (capacity == 0) {
+			return nullptr;
+		}
+		T* slot = &records[head];
+		head = (head + 1) % capacity;
+		if (count < capacity) {
+			count++;
+		} else {
+			overwritten++;
+		}
+		*slot = T{};
+		return slot;
+	}
+	// i-th record counted from the oldest one.
+	const T& at(size_t i) const { return records[(head + capacity - count + i) % capacity]; }
+	size_t size() const { return count; }
+	size_t get_capacity() const { return capacity; }
+	uint32_t get_overwritten() const { return overwritten; }
+	void clear() {
+		head = 0;
+		count = 0;
+		overwritten = 0;
+	}
+
+ private:
+	T* records = nullptr;
+	size_t capacity = 0;
+	size_t head = 0;
+	size_t count = 0;
+	uint32_t overwritten = 0;
+};
+
+}  // namespace esphome::sesame_server
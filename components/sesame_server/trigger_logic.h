@@ -0,0 +1,150 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+// Command handling logic of SesameTrigger that does not depend on ESPHome, NimBLE or libsesame3bt,
+// so that it can be built and tested on the host (see tests/).
+
+namespace esphome::sesame_server {
+
+// FNV-1a hash of a history tag. Same as fnv1a_hash() in __init__.py, which hashes route tags at compile time.
+constexpr uint32_t
+fnv1a_hash(std::string_view str) {
+	uint32_t hash = 2166136261u;
+	for (auto c : str) {
+		hash = (hash ^ static_cast<uint8_t>(c)) * 16777619u;
+	}
+	return hash;
+}
+
+// Event mask bit of a command: bit 0 open, 1 close, 2 lock, 3 unlock, 0 for other item codes.
+template <typename ItemCode>
+constexpr uint8_t
+event_bit(ItemCode cmd) {
+	switch (cmd) {
+		case ItemCode::door_open:
+			return 1 << 0;
+		case ItemCode::door_closed:
+			return 1 << 1;
+		case ItemCode::lock:
+			return 1 << 2;
+		case ItemCode::unlock:
+			return 1 << 3;
+		default:
+			return 0;
+	}
+}
+
+// Battery curve used to convert the scaled voltage reported with a command.
+enum class battery_model_t : uint8_t { sesame_5, open_sensor };
+
+// Open Sensor and Remote nano report their own battery, other devices use the SESAME 5 curve.
+template <typename HistoryTagType>
+constexpr battery_model_t
+battery_model(HistoryTagType history_tag_type) {
+	return history_tag_type == HistoryTagType::open_sensor || history_tag_type == HistoryTagType::remote_nano
+	           ? battery_model_t::open_sensor
+	           : battery_model_t::sesame_5;
+}
+
+// Whether `value` should be published over `published`: NaN-ness changed, or the difference reaches the deadband.
+inline bool
+float_changed(float published, float value, float deadband) {
+	if (std::isnan(published) || std::isnan(value)) {
+		return std::isnan(published) != std::isnan(value);
+	}
+	return published != value && std::fabs(published - value) >= deadband;
+}
+
+// Suppresses a command repeating the last accepted event type and history tag within the window.
+class DedupFilter {
+ public:
+	void set_window(uint32_t ms) { window_ms = ms; }
+	uint32_t get_window() const { return window_ms; }
+	// `now_ms` is the time the command was received, in millis().
+	bool is_duplicate(uint8_t code, uint32_t tag_hash, uint32_t now_ms) {
+		if (window_ms == 0) {
+			return false;
+		}
+		if (last_code == code && last_tag_hash == tag_hash && now_ms - last_ms < window_ms) {
+			suppressed_count++;
+			return true;
+		}
+		last_code = code;
+		last_tag_hash = tag_hash;
+		last_ms = now_ms;
+		return false;
+	}
+	uint32_t get_suppressed_count() const { return suppressed_count; }
+
+ private:
+	uint32_t window_ms = 0;
+	uint32_t last_ms = 0;
+	uint32_t last_tag_hash = 0;
+	uint32_t suppressed_count = 0;
+	std::optional<uint8_t> last_code;
+};
+
+// Routes matched by event bit, history tag and history tag type.
+// Routes with a tag are kept sorted by tag hash and found by binary search, routes matching any tag follow them.
+template <typename Target>
+class RouteTable {
+ public:
+	struct route_t {
+		uint32_t tag_hash;
+		const char* tag;           // nullptr matches any tag
+		uint8_t event_mask;        // see event_bit()
+		int16_t history_tag_type;  // -1 matches any type
+		Target target;
+	};
+
+	void add(uint32_t tag_hash, const char* tag, uint8_t event_mask, int16_t history_tag_type, Target target) {
+		route_t route{tag_hash, tag, event_mask, history_tag_type, target};
+		if (tag == nullptr) {
+			routes.push_back(route);
+			return;
+		}
+		auto tagged_end = routes.begin() + tagged_count;
+		auto pos = std::upper_bound(routes.begin(), tagged_end, tag_hash,
+		                            [](uint32_t hash, const route_t& r) { return hash < r.tag_hash; });
+		routes.insert(pos, route);
+		tagged_count++;
+	}
+	// Calls `fn(target)` for each route matching the command, tagged routes first.
+	template <typename F>
+	void dispatch(uint8_t event_bit, std::string_view tag, int16_t history_tag_type, F&& fn) const {
+		if (routes.empty()) {
+			return;
+		}
+		auto matches = [event_bit, history_tag_type](const route_t& r) {
+			return (r.event_mask & event_bit) != 0 && (r.history_tag_type < 0 || r.history_tag_type == history_tag_type);
+		};
+		auto tagged_end = routes.cbegin() + tagged_count;
+		auto hash = fnv1a_hash(tag);
+		auto it =
+		    std::lower_bound(routes.cbegin(), tagged_end, hash, [](const route_t& r, uint32_t hash) { return r.tag_hash < hash; });
+		for (; it != tagged_end && it->tag_hash == hash; ++it) {
+			if (matches(*it) && tag == it->tag) {
+				fn(it->target);
+			}
+		}
+		for (it = tagged_end; it != routes.cend(); ++it) {
+			if (matches(*it)) {
+				fn(it->target);
+			}
+		}
+	}
+	bool empty() const { return routes.empty(); }
+	size_t size() const { return routes.size(); }
+
+ private:
+	std::vector<route_t> routes;
+	size_t tagged_count = 0;
+};
+
+}  // namespace esphome::sesame_server
@@ -0,0 +1,119 @@
+// Replays a trace printed by dump_trace() through a host build of the component:
+//   sesame_server_replay [-s max_sessions] [-t aa:bb:cc:dd:ee:ff/type]... trace.log
+// Each -t adds a trigger. Set SESAME_SERVER_TEST_LOG to see the log of the replayed component.
+#include <unistd.h>
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "trace_replay.h"
+
+using esphome::sesame_server::SesameServerComponent;
+using esphome::sesame_server::SesameTrigger;
+using esphome::sesame_server::replay::parse_trace_line;
+using esphome::sesame_server::replay::TraceReplayer;
+
+namespace {
+
+constexpr const char UUID[] = "00000000-0000-0000-0000-000000000000";
+
+bool
+parse_trigger(const char* str, uint64_t& key) {
+	unsigned a[6], type;
+	if (std::sscanf(str, "%2x:%2x:%2x:%2x:%2x:%2x/%u", &a[0], &a[1], &a[2], &a[3], &a[4], &a[5], &type) != 7) {
+		return false;
+	}
+	key = type;
+	for (auto v : a) {
+		key = (key << 8) | v;
+	}
+	return true;
+}
+
+int
+usage(const char* name) {
+	std::fprintf(stderr, "usage: %s [-s max_sessions] [-t aa:bb:cc:dd:ee:ff/type]... trace.log\n", name);
+	return 2;
+}
+
+}  // namespace
+
+int
+main(int argc, char** argv) {
+	unsigned max_sessions = 3;
+	std::vector<uint64_t> triggers;
+	int opt;
+	while ((opt = getopt(argc, argv, "s:t:")) != -1) {
+		switch (opt) {
+			case 's':
+				max_sessions = std::strtoul(optarg, nullptr, 10);
+				break;
+			case 't': {
+				uint64_t key;
+				if (!parse_trigger(optarg, key)) {
+					return usage(argv[0]);
+				}
+				triggers.push_back(key);
+				break;
+			}
+			default:
+				return usage(argv[0]);
+		}
+	}
+	if (optind + 1 != argc || max_sessions == 0 || max_sessions > 255) {
+		return usage(argv[0]);
+	}
+	std::ifstream in{argv[optind]};
+	if (!in) {
+		std::fprintf(stderr, "%s: cannot open\n", argv[optind]);
+		return 1;
+	}
+
+	esphome::test::set_now_us(uint64_t{1000} * 1000 * 1000);
+	SesameServerComponent server{static_cast<uint8_t>(max_sessions), UUID};
+	auto& ble = *libsesame3bt::SesameServer::last_instance;
+	// Triggers must be added sorted by address, as codegen does
+	std::sort(triggers.begin(), triggers.end());
+	triggers.erase(std::unique(triggers.begin(), triggers.end()), triggers.end());
+	std::vector<SesameTrigger*> trigs;
+	for (size_t i = 0; i < triggers.size(); i++) {
+		auto name = "trigger" + std::to_string(i);
+		trigs.push_back(new SesameTrigger(&server, triggers[i]));
+		trigs.back()->set_name(name.c_str());
+		server.add_trigger(trigs.back());
+	}
+	server.setup();
+	if (server.is_failed()) {
+		std::fprintf(stderr, "setup failed\n");
+		return 1;
+	}
+
+	TraceReplayer replayer{server, ble};
+	std::string line;
+	unsigned skipped = 0;
+	while (std::getline(in, line)) {
+		if (auto rec = parse_trace_line(line)) {
+			replayer.feed(*rec);
+		} else if (line.find(" T ") != std::string::npos || line.rfind("T ", 0) == 0) {
+			skipped++;
+		}
+	}
+	replayer.finish();
+
+	const auto& stats = replayer.get_stats();
+	std::printf("records: %" PRIu32 " (%u malformed lines skipped)\n", stats.records, skipped);
+	std::printf("connects: %" PRIu32 ", rejected: %" PRIu32 ", disconnects: %" PRIu32 "\n", stats.connects,
+	            stats.rejected_connects, stats.disconnects);
+	std::printf("commands: %" PRIu32 "\n", stats.commands);
+	std::printf("lock state sends: %" PRIu32 " recorded, %" PRIu32 " replayed\n", stats.lock_states_recorded,
+	            stats.lock_states_sent);
+	for (const auto* trig : trigs) {
+		std::printf("%s %s: %zu events\n", trig->get_name().c_str(), trig->get_address().toString().c_str(),
+		            trig->triggered.size());
+	}
+	return 0;
+}
@@ -0,0 +1,125 @@
+#pragma once
+// Host stand-in for the parts of NimBLE-Arduino used by sesame_server.
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#define BLE_ADDR_PUBLIC 0
+#define BLE_ADDR_RANDOM 1
+
+struct ble_addr_t {
+	uint8_t type;
+	uint8_t val[6];  // least significant byte first
+};
+
+class NimBLEAddress {
+ public:
+	NimBLEAddress() = default;
+	NimBLEAddress(const ble_addr_t& addr) : addr(addr) {}
+	// "aa:bb:cc:dd:ee:ff", stays null if malformed
+	NimBLEAddress(const std::string& str, uint8_t type) {
+		unsigned v[6];
+		if (std::sscanf(str.c_str(), "%2x:%2x:%2x:%2x:%2x:%2x", &v[0], &v[1], &v[2], &v[3], &v[4], &v[5]) != 6) {
+			return;
+		}
+		addr.type = type;
+		for (int i = 0; i < 6; i++) {
+			addr.val[5 - i] = v[i];
+		}
+	}
+	bool isNull() const {
+		for (auto v : addr.val) {
+			if (v != 0) {
+				return false;
+			}
+		}
+		return true;
+	}
+	std::string toString() const {
+		char buf[18];
+		std::snprintf(buf, sizeof(buf), "%02x:%02x:%02x:%02x:%02x:%02x", addr.val[5], addr.val[4], addr.val[3], addr.val[2],
+		              addr.val[1], addr.val[0]);
+		return buf;
+	}
+	const uint8_t* getVal() const { return addr.val; }
+	uint8_t getType() const { return addr.type; }
+	const ble_addr_t* getBase() const { return &addr; }
+	bool operator==(const NimBLEAddress& other) const {
+		return addr.type == other.addr.type && std::memcmp(addr.val, other.addr.val, sizeof(addr.val)) == 0;
+	}
+	bool operator!=(const NimBLEAddress& other) const { return !(*this == other); }
+
+ private:
+	ble_addr_t addr{};
+};
+
+class NimBLEUUID {
+ public:
+	NimBLEUUID() = default;
+	explicit NimBLEUUID(const std::string& str) : str(str) {}
+	const std::string& toString() const { return str; }
+
+ private:
+	std::string str;
+};
+
+class NimBLEConnInfo {
+ public:
+	NimBLEConnInfo() = default;
+	NimBLEConnInfo(const NimBLEAddress& address, uint16_t handle) : address(address), handle(handle) {}
+	NimBLEAddress getAddress() const { return address; }
+	NimBLEAddress getIdAddress() const { return address; }
+	uint16_t getConnHandle() const { return handle; }
+
+ private:
+	NimBLEAddress address;
+	uint16_t handle = 0xffff;
+};
+
+class NimBLEAdvertising {
+ public:
+	void setMinInterval(uint16_t interval) { min_interval = interval; }
+	void setMaxInterval(uint16_t interval) { max_interval = interval; }
+
+	// Test hooks
+	uint16_t min_interval = 0;
+	uint16_t max_interval = 0;
+};
+
+class NimBLEServer {
+ public:
+	struct conn_params_t {
+		uint16_t handle, min_interval, max_interval, latency, timeout;
+	};
+
+	NimBLEConnInfo getPeerInfo(const NimBLEAddress& address) {
+		for (size_t i = 0; i < peers.size(); i++) {
+			if (peers[i] == address) {
+				return {address, static_cast<uint16_t>(i)};
+			}
+		}
+		return {};
+	}
+	void updateConnParams(uint16_t handle, uint16_t min_interval, uint16_t max_interval, uint16_t latency, uint16_t timeout) {
+		conn_params.push_back({handle, min_interval, max_interval, latency, timeout});
+	}
+
+	// Test hooks: connected peers (handle is the position) and requested connection parameters
+	std::vector<NimBLEAddress> peers;
+	std::vector<conn_params_t> conn_params;
+};
+
+class NimBLEDevice {
+ public:
+	static NimBLEAddress getAddress() { return NimBLEAddress{std::string{"02:00:00:00:00:01"}, BLE_ADDR_PUBLIC}; }
+	static NimBLEAdvertising* getAdvertising() {
+		static NimBLEAdvertising advertising;
+		return &advertising;
+	}
+	static NimBLEServer* getServer() {
+		static NimBLEServer server;
+		return &server;
+	}
+};
@@ -0,0 +1,128 @@
+#pragma once
+// Host stand-in for libsesame3bt::SesameServer. Callbacks and outgoing traffic are exposed to the tests.
+#include <NimBLEDevice.h>
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace libsesame3bt {
+
+enum class history_tag_type_t : uint8_t { none = 0, open_sensor = 1, remote_nano = 2, ios_app = 0x1d };
+
+struct Sesame {
+	static constexpr size_t SECRET_SIZE = 16;
+	enum class item_code_t : uint8_t { none = 0, lock = 82, unlock = 83, door_open = 90, door_closed = 91 };
+	enum class model_t : int8_t { sesame_5 = 5, open_sensor_1 = 8 };
+	enum class result_code_t : uint8_t { success = 0, unknown = 3 };
+	struct mecha_setting_5_t {
+		int16_t lock_position;
+		int16_t unlock_position;
+		uint16_t auto_lock_sec;
+	};
+	struct mecha_status_5_t {
+		uint16_t battery;
+		int16_t target;
+		int16_t position;
+		bool in_lock;
+		bool in_unlock;
+		bool is_critical;
+		bool is_stop;
+	};
+};
+
+class SesameServer {
+ public:
+	using secret_t = std::array<std::byte, Sesame::SECRET_SIZE>;
+	using registration_callback_t = std::function<void(const NimBLEAddress&, const secret_t&)>;
+	using command_callback_t = std::function<Sesame::result_code_t(const NimBLEAddress&,
+	                                                               Sesame::item_code_t,
+	                                                               const std::string&,
+	                                                               std::optional<history_tag_type_t>,
+	                                                               float,
+	                                                               float,
+	                                                               std::string_view)>;
+	using connect_callback_t = std::function<void(const NimBLEAddress&)>;
+	using disconnect_callback_t = std::function<void(const NimBLEAddress&, int)>;
+	using connect_check_callback_t = std::function<bool(const NimBLEAddress&)>;
+
+	explicit SesameServer(uint8_t max_sessions) : max_sessions(max_sessions) { last_instance = this; }
+	~SesameServer() {
+		if (last_instance == this) {
+			last_instance = nullptr;
+		}
+	}
+	bool begin(Sesame::model_t, const NimBLEUUID&) { return begin_result; }
+	void update() { update_count++; }
+	bool start_advertising() {
+		advertising = true;
+		return true;
+	}
+	bool stop_advertising() {
+		advertising = false;
+		return true;
+	}
+	bool is_registered() const { return registered; }
+	bool set_registered(const secret_t& secret) {
+		this->secret = secret;
+		registered = true;
+		return true;
+	}
+	void set_on_registration_callback(registration_callback_t callback) { on_registration = std::move(callback); }
+	void set_on_command_callback(command_callback_t callback) { on_command = std::move(callback); }
+	void set_on_connect_callback(connect_callback_t callback) { on_connect = std::move(callback); }
+	void set_on_disconnect_callback(disconnect_callback_t callback) { on_disconnect = std::move(callback); }
+	void set_connect_check_callback(connect_check_callback_t callback) { connect_check = std::move(callback); }
+	void set_mecha_setting(const Sesame::mecha_setting_5_t& setting) { mecha_setting = setting; }
+	void set_mecha_status(const Sesame::mecha_status_5_t& status) { mecha_status = status; }
+	bool send_mecha_status(const NimBLEAddress* address, const Sesame::mecha_status_5_t& status) {
+		if (send_failures > 0) {
+			send_failures--;
+			return false;
+		}
+		sent.push_back({address ? *address : NimBLEAddress{}, status});
+		return true;
+	}
+	bool has_session(const NimBLEAddress& address) const {
+		return std::find(std::cbegin(sessions), std::cend(sessions), address) != std::cend(sessions);
+	}
+	size_t get_session_count() const { return sessions.size(); }
+	void disconnect(const NimBLEAddress& address) {
+		disconnected.push_back(address);
+		sessions.erase(std::remove(std::begin(sessions), std::end(sessions), address), std::end(sessions));
+	}
+	void set_version_tag(std::string_view tag) { version_tag = tag; }
+	// Null if the UUID is malformed, see host_sesame_server.cpp
+	static NimBLEAddress uuid_to_ble_address(const NimBLEUUID& uuid);
+	// Test hooks
+	struct sent_t {
+		NimBLEAddress address;  // null for broadcasts
+		Sesame::mecha_status_5_t status;
+	};
+	static inline SesameServer* last_instance = nullptr;
+	uint8_t max_sessions;
+	bool begin_result = true;
+	bool registered = true;
+	bool advertising = false;
+	uint32_t update_count = 0;
+	unsigned send_failures = 0;  // the next sends to fail
+	std::optional<secret_t> secret;
+	std::vector<NimBLEAddress> sessions;
+	std::vector<NimBLEAddress> disconnected;
+	std::vector<sent_t> sent;
+	std::optional<Sesame::mecha_setting_5_t> mecha_setting;
+	std::optional<Sesame::mecha_status_5_t> mecha_status;
+	std::string version_tag;
+	registration_callback_t on_registration;
+	command_callback_t on_command;
+	connect_callback_t on_connect;
+	disconnect_callback_t on_disconnect;
+	connect_check_callback_t connect_check;
+};
+
+}  // namespace libsesame3bt
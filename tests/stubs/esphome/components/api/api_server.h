@@ -0,0 +1,16 @@
+#pragma once
+
+namespace esphome::api {
+
+// Host stand-in for the API server, only its connection state is used
+class APIServer {
+ public:
+	bool is_connected() const { return connected; }
+
+	// Test hooks
+	bool connected = false;
+};
+
+inline APIServer* global_api_server = nullptr;
+
+}  // namespace esphome::api
@@ -0,0 +1,22 @@
+#pragma once
+#include <map>
+#include <string>
+#include <vector>
+
+namespace esphome::api {
+
+class CustomAPIDevice {
+ public:
+	void fire_homeassistant_event(const std::string& event_name, const std::map<std::string, std::string>& data = {}) {
+		events.push_back({event_name, data});
+	}
+
+	// Test hooks
+	struct event_t {
+		std::string name;
+		std::map<std::string, std::string> data;
+	};
+	std::vector<event_t> events;
+};
+
+}  // namespace esphome::api
@@ -0,0 +1,21 @@
+#pragma once
+#include <cstdint>
+#include "esphome/core/component.h"
+
+namespace esphome::binary_sensor {
+
+class BinarySensor : public EntityBase {
+ public:
+	void publish_state(bool state) {
+		this->state = state;
+		publish_count++;
+	}
+	bool has_state() const { return publish_count > 0; }
+
+	bool state = false;
+
+	// Test hooks
+	uint32_t publish_count = 0;
+};
+
+}  // namespace esphome::binary_sensor
@@ -0,0 +1,24 @@
+#pragma once
+#include <initializer_list>
+#include <set>
+#include <string>
+#include <vector>
+#include "esphome/core/component.h"
+
+namespace esphome::event {
+
+class Event : public EntityBase {
+ public:
+	void trigger(const std::string& event_type) { triggered.push_back(event_type); }
+	void set_event_types(std::initializer_list<const char*> event_types) {
+		this->event_types.clear();
+		this->event_types.insert(event_types.begin(), event_types.end());
+	}
+	void set_event_types(const std::set<std::string>& event_types) { this->event_types = event_types; }
+
+	// Test hooks
+	std::set<std::string> event_types;
+	std::vector<std::string> triggered;
+};
+
+}  // namespace esphome::event
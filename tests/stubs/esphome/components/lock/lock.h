@@ -0,0 +1,36 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <vector>
+#include "esphome/core/component.h"
+
+namespace esphome::lock {
+
+enum LockState : uint8_t {
+	LOCK_STATE_NONE = 0,
+	LOCK_STATE_LOCKED = 1,
+	LOCK_STATE_UNLOCKED = 2,
+	LOCK_STATE_JAMMED = 3,
+	LOCK_STATE_LOCKING = 4,
+	LOCK_STATE_UNLOCKING = 5,
+};
+
+const char* lock_state_to_string(LockState state);
+
+class Lock : public EntityBase {
+ public:
+	void add_on_state_callback(std::function<void(LockState)>&& callback) { callbacks.push_back(std::move(callback)); }
+	void publish_state(LockState state) {
+		this->state = state;
+		for (auto& callback : callbacks) {
+			callback(state);
+		}
+	}
+
+	LockState state = LOCK_STATE_NONE;
+
+ private:
+	std::vector<std::function<void(LockState)>> callbacks;
+};
+
+}  // namespace esphome::lock
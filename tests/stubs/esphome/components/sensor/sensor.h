@@ -0,0 +1,26 @@
+#pragma once
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include "esphome/core/component.h"
+
+namespace esphome::sensor {
+
+class Sensor : public EntityBase {
+ public:
+	void publish_state(float state) {
+		raw_state = state;
+		this->state = filter ? filter(state) : state;
+		publish_count++;
+	}
+	bool has_state() const { return publish_count > 0; }
+
+	float state = NAN;
+	float raw_state = NAN;
+
+	// Test hooks: stand-in for the filter chain, and published states
+	std::function<float(float)> filter;
+	uint32_t publish_count = 0;
+};
+
+}  // namespace esphome::sensor
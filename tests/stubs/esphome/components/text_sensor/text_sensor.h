@@ -0,0 +1,26 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <string>
+#include "esphome/core/component.h"
+
+namespace esphome::text_sensor {
+
+class TextSensor : public EntityBase {
+ public:
+	void publish_state(const std::string& state) {
+		raw_state = state;
+		this->state = filter ? filter(state) : state;
+		publish_count++;
+	}
+	bool has_state() const { return publish_count > 0; }
+
+	std::string state;
+	std::string raw_state;
+
+	// Test hooks: stand-in for the filter chain, and published states
+	std::function<std::string(const std::string&)> filter;
+	uint32_t publish_count = 0;
+};
+
+}  // namespace esphome::text_sensor
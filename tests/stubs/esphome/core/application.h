@@ -0,0 +1,16 @@
+#pragma once
+#include <cstdint>
+
+namespace esphome {
+
+class Application {
+ public:
+	void safe_reboot() { reboot_count++; }
+
+	// Test hooks
+	uint32_t reboot_count = 0;
+};
+
+extern Application App;
+
+}  // namespace esphome
@@ -0,0 +1,16 @@
+#pragma once
+#include <tuple>
+#include <vector>
+
+namespace esphome {
+
+template <typename... Ts>
+class Trigger {
+ public:
+	void trigger(Ts... x) { calls.emplace_back(x...); }
+
+	// Test hooks
+	std::vector<std::tuple<Ts...>> calls;
+};
+
+}  // namespace esphome
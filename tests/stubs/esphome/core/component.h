@@ -0,0 +1,142 @@
+#pragma once
+// Host stand-in for esphome::Component with a scheduler driven by the fake clock (see hal.h).
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <string>
+#include <vector>
+#include "esphome/core/hal.h"
+
+namespace esphome {
+
+namespace setup_priority {
+constexpr float BLUETOOTH = 350.0f;
+constexpr float AFTER_BLUETOOTH = 300.0f;
+constexpr float AFTER_WIFI = 200.0f;
+}  // namespace setup_priority
+
+class Component {
+ public:
+	virtual ~Component() = default;
+	virtual void setup() {}
+	virtual void loop() {}
+	virtual void dump_config() {}
+	virtual float get_setup_priority() const { return 0.0f; }
+	void mark_failed() { failed = true; }
+	bool is_failed() const { return failed; }
+
+	// Test hooks
+	bool is_loop_enabled() const { return loop_running; }
+	bool has_timer(const std::string& name) const { return find_timer(name) != timers.cend(); }
+	// Runs the deferred callbacks
+	void run_deferred() {
+		while (!deferred.empty()) {
+			auto fn = std::move(deferred.front());
+			deferred.erase(deferred.begin());
+			fn();
+		}
+	}
+	// Advances the fake clock by `ms`, running the deferred callbacks and the timers as they become due
+	void advance(uint32_t ms) {
+		auto target = test::now_us() + uint64_t{ms} * 1000;
+		for (;;) {
+			run_deferred();
+			auto next = std::min_element(timers.begin(), timers.end(),
+			                             [](const timer_t& a, const timer_t& b) { return a.due_us < b.due_us; });
+			if (next == timers.end() || next->due_us > target) {
+				break;
+			}
+			test::set_now_us(std::max(test::now_us(), next->due_us));
+			auto fn = next->fn;
+			if (next->interval_ms) {
+				next->due_us += uint64_t{*next->interval_ms} * 1000;
+			} else {
+				timers.erase(next);
+			}
+			fn();
+		}
+		test::set_now_us(target);
+	}
+
+ protected:
+	void defer(std::function<void()>&& fn) { deferred.push_back(std::move(fn)); }
+	void set_timeout(const std::string& name, uint32_t ms, std::function<void()>&& fn) {
+		add_timer(name, ms, std::nullopt, std::move(fn));
+	}
+	void set_timeout(uint32_t ms, std::function<void()>&& fn) { add_timer({}, ms, std::nullopt, std::move(fn)); }
+	bool cancel_timeout(const std::string& name) { return cancel_timer(name); }
+	void set_interval(const std::string& name, uint32_t ms, std::function<void()>&& fn) {
+		add_timer(name, ms, ms, std::move(fn));
+	}
+	bool cancel_interval(const std::string& name) { return cancel_timer(name); }
+	void enable_loop() { loop_running = true; }
+	void disable_loop() { loop_running = false; }
+	void enable_loop_soon_any_context() { loop_running = true; }
+
+ private:
+	struct timer_t {
+		std::string name;
+		uint64_t due_us;
+		std::optional<uint32_t> interval_ms;
+		std::function<void()> fn;
+	};
+	std::vector<timer_t>::const_iterator find_timer(const std::string& name) const {
+		return std::find_if(timers.cbegin(), timers.cend(), [&name](const timer_t& t) { return t.name == name; });
+	}
+	void add_timer(const std::string& name, uint32_t ms, std::optional<uint32_t> interval_ms, std::function<void()>&& fn) {
+		if (!name.empty()) {
+			cancel_timer(name);
+		}
+		timers.push_back({name, test::now_us() + uint64_t{ms} * 1000, interval_ms, std::move(fn)});
+	}
+	bool cancel_timer(const std::string& name) {
+		auto it = find_timer(name);
+		if (it == timers.cend()) {
+			return false;
+		}
+		timers.erase(it);
+		return true;
+	}
+
+	std::vector<std::function<void()>> deferred;
+	std::vector<timer_t> timers;
+	bool failed = false;
+	// Set from other tasks by enable_loop_soon_any_context()
+	std::atomic<bool> loop_running{true};
+};
+
+// Loop without delay while at least one requester has started. The state is global, as in ESPHome.
+class HighFrequencyLoopRequester {
+ public:
+	void start() {
+		if (!started) {
+			started = true;
+			num_requests++;
+		}
+	}
+	void stop() {
+		if (started) {
+			started = false;
+			num_requests--;
+		}
+	}
+	static bool is_high_frequency() { return num_requests > 0; }
+
+ private:
+	static inline int num_requests = 0;
+	bool started = false;
+};
+
+class EntityBase {
+ public:
+	void set_name(const char* name) { this->name = name; }
+	const std::string& get_name() const { return name; }
+
+ private:
+	std::string name;
+};
+
+}  // namespace esphome
@@ -0,0 +1,2 @@
+#pragma once
+// The USE_SESAME_SERVER_* defines generated by codegen are passed by tests/CMakeLists.txt.
@@ -0,0 +1,19 @@
+#pragma once
+#include <cstdint>
+
+namespace esphome {
+
+uint32_t millis();
+uint32_t micros();
+
+namespace test {
+// Fake clock behind millis() and micros(), only advanced by the tests
+uint64_t now_us();
+void set_now_us(uint64_t us);
+inline void
+advance_us(uint64_t us) {
+	set_now_us(now_us() + us);
+}
+}  // namespace test
+
+}  // namespace esphome
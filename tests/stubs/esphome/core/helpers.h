@@ -0,0 +1,33 @@
+#pragma once
+#include <cstddef>
+#include <mutex>
+
+namespace esphome {
+
+class Mutex {
+ public:
+	void lock() { mutex.lock(); }
+	bool try_lock() { return mutex.try_lock(); }
+	void unlock() { mutex.unlock(); }
+
+ private:
+	std::mutex mutex;
+};
+
+class LockGuard {
+ public:
+	explicit LockGuard(Mutex& mutex) : mutex(mutex) { mutex.lock(); }
+	~LockGuard() { mutex.unlock(); }
+
+ private:
+	Mutex& mutex;
+};
+
+template <typename T>
+class RAMAllocator {
+ public:
+	T* allocate(size_t n) { return n > 0 ? static_cast<T*>(::operator new(n * sizeof(T))) : nullptr; }
+	void deallocate(T* p, size_t) { ::operator delete(p); }
+};
+
+}  // namespace esphome
@@ -0,0 +1,30 @@
+#pragma once
+#include <cstdarg>
+#include <functional>
+#include <string>
+
+namespace esphome::test {
+// Printed when SESAME_SERVER_TEST_LOG is set in the environment
+void log(char level, const char* tag, const char* format, ...) __attribute__((format(printf, 3, 4)));
+// Receives every formatted message in addition to the printing above, until reset with nullptr
+void set_log_sink(std::function<void(char level, const std::string& message)> sink);
+}  // namespace esphome::test
+
+#define ESP_LOGE(tag, ...) ::esphome::test::log('E', tag, __VA_ARGS__)
+#define ESP_LOGW(tag, ...) ::esphome::test::log('W', tag, __VA_ARGS__)
+#define ESP_LOGI(tag, ...) ::esphome::test::log('I', tag, __VA_ARGS__)
+#define ESP_LOGD(tag, ...) ::esphome::test::log('D', tag, __VA_ARGS__)
+// As in ESPHome, verbose messages and their arguments compile away below the verbose level
+#define ESPHOME_LOG_LEVEL_DEBUG 5
+#define ESPHOME_LOG_LEVEL_VERBOSE 6
+#ifndef ESPHOME_LOG_LEVEL
+#define ESPHOME_LOG_LEVEL ESPHOME_LOG_LEVEL_DEBUG
+#endif
+#if ESPHOME_LOG_LEVEL >= ESPHOME_LOG_LEVEL_VERBOSE
+#define ESP_LOGV(tag, ...) ::esphome::test::log('V', tag, __VA_ARGS__)
+#else
+#define ESP_LOGV(tag, ...)
+#endif
+#define ESP_LOGCONFIG(tag, ...) ::esphome::test::log('C', tag, __VA_ARGS__)
+#define LOG_STR_ARG(s) (s)
+#define YESNO(b) ((b) ? "YES" : "NO")
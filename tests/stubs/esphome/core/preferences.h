@@ -0,0 +1,72 @@
+#pragma once
+// In-memory stand-in for the flash preferences.
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <vector>
+
+namespace esphome {
+
+class ESPPreferences;
+
+class ESPPreferenceObject {
+ public:
+	ESPPreferenceObject() = default;
+	ESPPreferenceObject(ESPPreferences* prefs, uint32_t key, size_t size) : prefs(prefs), key(key), size(size) {}
+	template <typename T>
+	bool save(const T* src);
+	template <typename T>
+	bool load(T* dest);
+
+ private:
+	ESPPreferences* prefs = nullptr;
+	uint32_t key = 0;
+	size_t size = 0;
+};
+
+class ESPPreferences {
+ public:
+	template <typename T>
+	ESPPreferenceObject make_preference(uint32_t key) {
+		return {this, key, sizeof(T)};
+	}
+	bool sync() {
+		sync_count++;
+		return true;
+	}
+
+	// Test hooks
+	std::map<uint32_t, std::vector<std::byte>> slots;
+	uint32_t sync_count = 0;
+};
+
+extern ESPPreferences* global_preferences;
+
+template <typename T>
+bool
+ESPPreferenceObject::save(const T* src) {
+	if (prefs == nullptr || sizeof(T) != size) {
+		return false;
+	}
+	auto& slot = prefs->slots[key];
+	slot.resize(size);
+	std::memcpy(slot.data(), src, size);
+	return true;
+}
+
+template <typename T>
+bool
+ESPPreferenceObject::load(T* dest) {
+	if (prefs == nullptr || sizeof(T) != size) {
+		return false;
+	}
+	auto it = prefs->slots.find(key);
+	if (it == prefs->slots.end() || it->second.size() != size) {
+		return false;
+	}
+	std::memcpy(dest, it->second.data(), size);
+	return true;
+}
+
+}  // namespace esphome
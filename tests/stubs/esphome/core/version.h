@@ -0,0 +1,3 @@
+#pragma once
+#define VERSION_CODE(major, minor, patch) ((major) << 16 | (minor) << 8 | (patch))
+#define ESPHOME_VERSION_CODE VERSION_CODE(2026, 4, 0)
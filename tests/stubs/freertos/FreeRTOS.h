@@ -0,0 +1,15 @@
+#pragma once
+// Host stand-in for the FreeRTOS types and macros used by sesame_server, see task.h.
+#include <cstdint>
+
+using BaseType_t = int;
+using UBaseType_t = unsigned;
+using TickType_t = uint32_t;
+
+#define pdTRUE 1
+#define pdFALSE 0
+#define pdPASS pdTRUE
+#define pdFAIL pdFALSE
+#define portMAX_DELAY UINT32_MAX
+// One tick per millisecond
+#define pdMS_TO_TICKS(ms) (static_cast<TickType_t>(ms))
@@ -0,0 +1,26 @@
+#pragma once
+// Host stand-in for FreeRTOS tasks on std::thread. Task notifications wait on a condition variable in real time.
+// The core and priority are ignored. Tasks run until test::stop_tasks(), which must be called before the objects they
+// use are destroyed.
+#include <freertos/FreeRTOS.h>
+#include <cstdint>
+
+struct host_task_t;
+using TaskHandle_t = host_task_t*;
+using TaskFunction_t = void (*)(void*);
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn,
+                                   const char* name,
+                                   uint32_t stack_size,
+                                   void* arg,
+                                   UBaseType_t priority,
+                                   TaskHandle_t* handle,
+                                   BaseType_t core);
+BaseType_t xTaskNotifyGive(TaskHandle_t task);
+// Called from a task only. Returns the notification count before clearing or decrementing it, 0 on timeout.
+uint32_t ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t ticks_to_wait);
+
+namespace esphome::test {
+// Ends every task at its next ulTaskNotifyTake() and waits for them
+void stop_tasks();
+}  // namespace esphome::test
@@ -0,0 +1,91 @@
+// Globals and functions of the host stand-ins.
+#include <esphome/components/lock/lock.h>
+#include <esphome/core/application.h>
+#include <esphome/core/hal.h>
+#include <esphome/core/log.h>
+#include <esphome/core/preferences.h>
+#include <cstdio>
+#include <cstdlib>
+
+namespace esphome {
+
+namespace {
+uint64_t clock_us = 0;
+ESPPreferences preferences;
+std::function<void(char, const std::string&)> log_sink;
+}  // namespace
+
+Application App;
+ESPPreferences* global_preferences = &preferences;
+
+uint32_t
+millis() {
+	return static_cast<uint32_t>(clock_us / 1000);
+}
+
+uint32_t
+micros() {
+	return static_cast<uint32_t>(clock_us);
+}
+
+namespace test {
+
+uint64_t
+now_us() {
+	return clock_us;
+}
+
+void
+set_now_us(uint64_t us) {
+	clock_us = us;
+}
+
+void
+log(char level, const char* tag, const char* format, ...) {
+	static const bool enabled = std::getenv("SESAME_SERVER_TEST_LOG") != nullptr;
+	if (!enabled && !log_sink) {
+		return;
+	}
+	char message[512];
+	va_list args;
+	va_start(args, format);
+	std::vsnprintf(message, sizeof(message), format, args);
+	va_end(args);
+	if (enabled) {
+		std::printf("[%c][%s] %s\n", level, tag, message);
+	}
+	if (log_sink) {
+		log_sink(level, message);
+	}
+}
+
+void
+set_log_sink(std::function<void(char, const std::string&)> sink) {
+	log_sink = std::move(sink);
+}
+
+}  // namespace test
+
+namespace lock {
+
+const char*
+lock_state_to_string(LockState state) {
+	switch (state) {
+		case LOCK_STATE_LOCKED:
+			return "LOCKED";
+		case LOCK_STATE_UNLOCKED:
+			return "UNLOCKED";
+		case LOCK_STATE_JAMMED:
+			return "JAMMED";
+		case LOCK_STATE_LOCKING:
+			return "LOCKING";
+		case LOCK_STATE_UNLOCKING:
+			return "UNLOCKING";
+		default:
+			return "UNKNOWN";
+	}
+}
+
+}  // namespace lock
+
+}  // namespace esphome
@@ -0,0 +1,45 @@
+// Address derivation of libsesame3bt::SesameServer, on OpenSSL instead of mbedTLS.
+#include <SesameServer.h>
+#include <openssl/core_names.h>
+#include <openssl/evp.h>
+#include <algorithm>
+#include <cstdio>
+#include <iterator>
+
+namespace libsesame3bt {
+
+NimBLEAddress
+SesameServer::uuid_to_ble_address(const NimBLEUUID& uuid) {
+	// AES-CMAC of "candy" keyed with the UUID bytes in string order
+	unsigned v[16];
+	if (std::sscanf(uuid.toString().c_str(), "%2x%2x%2x%2x-%2x%2x-%2x%2x-%2x%2x-%2x%2x%2x%2x%2x%2x", &v[0], &v[1], &v[2], &v[3],
+	                &v[4], &v[5], &v[6], &v[7], &v[8], &v[9], &v[10], &v[11], &v[12], &v[13], &v[14], &v[15]) != 16) {
+		return {};
+	}
+	unsigned char key[16];
+	for (size_t i = 0; i < std::size(key); i++) {
+		key[i] = v[i];
+	}
+	static const char message[] = "candy";
+	unsigned char mac[16];
+	size_t mac_len = 0;
+	char cipher[] = "AES-128-CBC";
+	OSSL_PARAM params[] = {OSSL_PARAM_construct_utf8_string(OSSL_MAC_PARAM_CIPHER, cipher, 0), OSSL_PARAM_construct_end()};
+	auto* cmac = EVP_MAC_fetch(nullptr, "CMAC", nullptr);
+	auto* ctx = cmac ? EVP_MAC_CTX_new(cmac) : nullptr;
+	bool ok = ctx && EVP_MAC_init(ctx, key, sizeof(key), params) &&
+	          EVP_MAC_update(ctx, reinterpret_cast<const unsigned char*>(message), sizeof(message) - 1) &&
+	          EVP_MAC_final(ctx, mac, &mac_len, sizeof(mac));
+	EVP_MAC_CTX_free(ctx);
+	EVP_MAC_free(cmac);
+	if (!ok) {
+		return {};
+	}
+	// The first 6 bytes, least significant first, as a static random address
+	ble_addr_t addr{BLE_ADDR_RANDOM, {}};
+	std::copy(mac, mac + std::size(addr.val), addr.val);
+	addr.val[5] |= 0xc0;
+	return addr;
+}
+
+}  // namespace libsesame3bt
@@ -0,0 +1,98 @@
+// FreeRTOS task stand-in on std::thread, see freertos/task.h.
+#include <freertos/task.h>
+#include <chrono>
+#include <condition_variable>
+#include <list>
+#include <mutex>
+#include <thread>
+
+struct host_task_t {
+	std::mutex mutex;
+	std::condition_variable cv;
+	uint32_t notifications = 0;
+	bool stop_requested = false;
+	std::thread thread;
+};
+
+namespace {
+
+// Thrown out of ulTaskNotifyTake() to unwind a task function that never returns
+struct task_stopped_t {};
+
+std::mutex tasks_mutex;
+std::list<host_task_t> tasks;
+thread_local host_task_t* current_task = nullptr;
+
+}  // namespace
+
+BaseType_t
+xTaskCreatePinnedToCore(TaskFunction_t fn,
+                        const char*,
+                        uint32_t,
+                        void* arg,
+                        UBaseType_t,
+                        TaskHandle_t* handle,
+                        BaseType_t) {
+	std::lock_guard<std::mutex> lock{tasks_mutex};
+	auto& task = tasks.emplace_back();
+	if (handle) {
+		*handle = &task;
+	}
+	task.thread = std::thread{[&task, fn, arg]() {
+		current_task = &task;
+		try {
+			fn(arg);
+		} catch (const task_stopped_t&) {
+		}
+	}};
+	return pdPASS;
+}
+
+BaseType_t
+xTaskNotifyGive(TaskHandle_t task) {
+	{
+		std::lock_guard<std::mutex> lock{task->mutex};
+		task->notifications++;
+	}
+	task->cv.notify_one();
+	return pdPASS;
+}
+
+uint32_t
+ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t ticks_to_wait) {
+	auto* task = current_task;
+	std::unique_lock<std::mutex> lock{task->mutex};
+	auto ready = [task]() { return task->notifications > 0 || task->stop_requested; };
+	// Timed waits only, the untimed one needs a newer libstdc++ than some toolchains ship with GTest
+	bool forever = ticks_to_wait == portMAX_DELAY;
+	while (!task->cv.wait_for(lock, std::chrono::milliseconds{forever ? 60 * 1000 : ticks_to_wait}, ready) && forever) {
+	}
+	if (task->stop_requested) {
+		throw task_stopped_t{};
+	}
+	auto count = task->notifications;
+	if (count > 0) {
+		task->notifications = clear_on_exit ? 0 : count - 1;
+	}
+	return count;
+}
+
+namespace esphome::test {
+
+void
+stop_tasks() {
+	std::lock_guard<std::mutex> lock{tasks_mutex};
+	for (auto& task : tasks) {
+		{
+			std::lock_guard<std::mutex> task_lock{task.mutex};
+			task.stop_requested = true;
+		}
+		task.cv.notify_one();
+	}
+	for (auto& task : tasks) {
+		task.thread.join();
+	}
+	tasks.clear();
+}
+
+}  // namespace esphome::test
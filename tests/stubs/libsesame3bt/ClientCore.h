@@ -0,0 +1,18 @@
+#pragma once
+// Host stand-in for libsesame3bt::core::Status with a linear battery curve per model.
+#include <SesameServer.h>
+#include <algorithm>
+
+namespace libsesame3bt::core {
+
+class Status {
+ public:
+	static float scaled_voltage_to_pct(float scaled_voltage, Sesame::model_t model) {
+		// SESAME 5: 5.0V-6.0V, Open Sensor: 2.5V-3.0V
+		float empty = model == Sesame::model_t::open_sensor_1 ? 2.5f : 5.0f;
+		float full = model == Sesame::model_t::open_sensor_1 ? 3.0f : 6.0f;
+		return std::clamp((scaled_voltage - empty) / (full - empty) * 100.0f, 0.0f, 100.0f);
+	}
+};
+
+}  // namespace libsesame3bt::core
@@ -0,0 +1,22 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace libsesame3bt::core::util {
+
+template <typename T>
+std::string
+bin2hex(const T* data, size_t size) {
+	static constexpr char digits[] = "0123456789abcdef";
+	std::string str;
+	str.reserve(size * 2);
+	for (size_t i = 0; i < size; i++) {
+		auto b = static_cast<uint8_t>(data[i]);
+		str.push_back(digits[b >> 4]);
+		str.push_back(digits[b & 0x0f]);
+	}
+	return str;
+}
+
+}  // namespace libsesame3bt::core::util
@@ -0,0 +1,85 @@
+#include <gtest/gtest.h>
+#include <thread>
+#include "event_queue.h"
+
+namespace esphome::sesame_server {
+namespace {
+
+TEST(EventQueueTest, FifoOrder) {
+	EventQueue<int, 4> queue;
+	EXPECT_TRUE(queue.empty());
+	EXPECT_EQ(queue.front(), nullptr);
+	for (int i = 1; i <= 3; i++) {
+		auto* slot = queue.prepare();
+		ASSERT_NE(slot, nullptr);
+		*slot = i;
+		queue.commit();
+	}
+	for (int i = 1; i <= 3; i++) {
+		ASSERT_NE(queue.front(), nullptr);
+		EXPECT_EQ(*queue.front(), i);
+		queue.pop();
+	}
+	EXPECT_TRUE(queue.empty());
+}
+
+TEST(EventQueueTest, PrepareFailsWhenFull) {
+	EventQueue<int, 2> queue;
+	for (int i = 0; i < 2; i++) {
+		ASSERT_NE(queue.prepare(), nullptr);
+		queue.commit();
+	}
+	EXPECT_EQ(queue.prepare(), nullptr);
+	queue.pop();
+	EXPECT_NE(queue.prepare(), nullptr);
+}
+
+TEST(EventQueueTest, UncommittedSlotIsNotVisible) {
+	EventQueue<int, 2> queue;
+	*queue.prepare() = 1;
+	EXPECT_EQ(queue.front(), nullptr);
+	EXPECT_TRUE(queue.empty());
+	queue.commit();
+	EXPECT_FALSE(queue.empty());
+}
+
+TEST(EventQueueTest, WrapsAround) {
+	EventQueue<int, 4> queue;
+	for (int i = 0; i < 10; i++) {
+		*queue.prepare() = i;
+		queue.commit();
+		EXPECT_EQ(*queue.front(), i);
+		queue.pop();
+	}
+	EXPECT_TRUE(queue.empty());
+}
+
+TEST(EventQueueTest, SingleProducerSingleConsumer) {
+	constexpr uint32_t COUNT = 100000;
+	EventQueue<uint32_t, 8> queue;
+	std::thread producer([&queue]() {
+		for (uint32_t i = 0; i < COUNT;) {
+			if (auto* slot = queue.prepare()) {
+				*slot = i++;
+				queue.commit();
+			} else {
+				std::this_thread::yield();
+			}
+		}
+	});
+	uint32_t expected = 0;
+	while (expected < COUNT) {
+		if (auto* value = queue.front()) {
+			ASSERT_EQ(*value, expected);
+			queue.pop();
+			expected++;
+		} else {
+			std::this_thread::yield();
+		}
+	}
+	producer.join();
+	EXPECT_TRUE(queue.empty());
+}
+
+}  // namespace
+}  // namespace esphome::sesame_server
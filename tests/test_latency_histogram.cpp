@@ -0,0 +1,52 @@
+#include <gtest/gtest.h>
+#include "latency_histogram.h"
+
+namespace esphome::sesame_server {
+namespace {
+
+TEST(LatencyHistogramTest, BucketBoundaries) {
+	EXPECT_EQ(LatencyHistogram::bucket_of(0), 0u);
+	EXPECT_EQ(LatencyHistogram::bucket_of(255), 0u);
+	EXPECT_EQ(LatencyHistogram::bucket_of(256), 1u);
+	EXPECT_EQ(LatencyHistogram::bucket_of(511), 1u);
+	EXPECT_EQ(LatencyHistogram::bucket_of(512), 2u);
+	EXPECT_EQ(LatencyHistogram::bucket_of(UINT32_MAX), LatencyHistogram::BUCKETS - 1);
+}
+
+TEST(LatencyHistogramTest, EmptyPercentileIsZero) {
+	LatencyHistogram histogram;
+	EXPECT_EQ(histogram.percentile(0.5f), 0u);
+	EXPECT_EQ(histogram.get_count(), 0u);
+}
+
+TEST(LatencyHistogramTest, PercentileIsBucketUpperBoundCappedAtMax) {
+	LatencyHistogram histogram;
+	for (int i = 0; i < 99; i++) {
+		histogram.record(100);  // bucket 0, [0, 256us)
+	}
+	histogram.record(3000);  // bucket 4, [2048us, 4096us)
+	EXPECT_EQ(histogram.get_count(), 100u);
+	EXPECT_EQ(histogram.get_max(), 3000u);
+	EXPECT_EQ(histogram.percentile(0.5f), 256u);
+	EXPECT_EQ(histogram.percentile(0.99f), 256u);
+	EXPECT_EQ(histogram.percentile(1.0f), 3000u);
+}
+
+TEST(LatencyHistogramTest, MergeAndReset) {
+	LatencyHistogram a;
+	LatencyHistogram b;
+	a.record(100);
+	b.record(1000);
+	b.record(1000);
+	a.merge(b);
+	EXPECT_EQ(a.get_count(), 3u);
+	EXPECT_EQ(a.get_max(), 1000u);
+	EXPECT_EQ(a.get_bucket_count(0), 1u);
+	EXPECT_EQ(a.get_bucket_count(LatencyHistogram::bucket_of(1000)), 2u);
+	a.reset();
+	EXPECT_EQ(a.get_count(), 0u);
+	EXPECT_EQ(a.get_max(), 0u);
+}
+
+}  // namespace
+}  // namespace esphome::sesame_server
@@ -0,0 +1,25 @@
+#include <gtest/gtest.h>
+#include "sesame_server_component.h"
+
+// Built without the USE_SESAME_SERVER_* defines, as for a configuration that uses none of the optional features.
+
+namespace esphome::sesame_server {
+namespace {
+
+// sizeof(SesameTrigger) on the host stand-ins before the optional features were added
+constexpr size_t BASELINE_TRIGGER_SIZE = 280;
+// SesameServerComponent state besides the BLE server and the command queue
+constexpr size_t COMPONENT_STATE_BUDGET = 768;
+
+TEST(MemoryLayoutTest, TriggerIsSmallerThanBaseline) {
+	EXPECT_LT(sizeof(SesameTrigger), BASELINE_TRIGGER_SIZE);
+}
+
+TEST(MemoryLayoutTest, ComponentStateWithinBudget) {
+	size_t state = sizeof(SesameServerComponent) - sizeof(libsesame3bt::SesameServer) -
+	               sizeof(command_event_t) * SESAME_SERVER_COMMAND_QUEUE_SIZE;
+	EXPECT_LE(state, COMPONENT_STATE_BUDGET);
+}
+
+}  // namespace
+}  // namespace esphome::sesame_server
@@ -0,0 +1,964 @@
+#include <gtest/gtest.h>
+#include <cmath>
+#include <memory>
+#include <string>
+#include <vector>
+#include "esphome/components/api/api_server.h"
+#include "sesame_server_component.h"
+
+namespace esphome::sesame_server {
+namespace {
+
+using libsesame3bt::history_tag_type_t;
+using libsesame3bt::Sesame;
+using libsesame3bt::SesameServer;
+using item_code_t = Sesame::item_code_t;
+
+constexpr const char UUID[] = "6ab3d2ca-7b5e-4c38-b5c4-2a1bd26f9d01";
+constexpr const char TRIGGER_ADDR[] = "cc:00:00:00:00:01";
+constexpr const char OTHER_TRIGGER_ADDR[] = "cc:00:00:00:00:02";
+constexpr const char APP_ADDR[] = "dd:00:00:00:00:01";
+constexpr const char APP2_ADDR[] = "dd:00:00:00:00:02";
+
+NimBLEAddress
+address(const char* str) {
+	return NimBLEAddress{std::string{str}, BLE_ADDR_RANDOM};
+}
+
+// Packed as (type << 48) | address, as generated by codegen
+uint64_t
+address_key(const char* str) {
+	auto addr = address(str);
+	uint64_t key = addr.getType();
+	for (int i = 5; i >= 0; i--) {
+		key = (key << 8) | addr.getVal()[i];
+	}
+	return key;
+}
+
+class SesameServerComponentTest : public ::testing::Test {
+ protected:
+	void SetUp() override {
+		test::set_now_us(1000 * 1000 * 1000);
+		global_preferences->slots.clear();
+		NimBLEDevice::getServer()->peers.clear();
+		NimBLEDevice::getServer()->conn_params.clear();
+	}
+	void TearDown() override { api::global_api_server = nullptr; }
+	SesameServer& ble() { return *SesameServer::last_instance; }
+	SesameTrigger* add_trigger(const char* addr, const char* name) {
+		auto* trig = new SesameTrigger(&server, address_key(addr));
+		trig->set_name(name);
+		server.add_trigger(trig);
+		return trig;
+	}
+	void start() {
+		server.setup();
+		ASSERT_FALSE(server.is_failed());
+	}
+	void command(const char* addr,
+	             item_code_t cmd,
+	             const std::string& tag = "",
+	             std::optional<history_tag_type_t> type = std::nullopt,
+	             float voltage = NAN,
+	             std::string_view extra = "") {
+		ble().on_command(address(addr), cmd, tag, type, voltage, NAN, extra);
+	}
+	bool connect_check(const char* addr) { return ble().connect_check(address(addr)); }
+	void connect(const char* addr) {
+		ASSERT_TRUE(connect_check(addr));
+		ble().sessions.push_back(address(addr));
+		ble().on_connect(address(addr));
+		server.run_deferred();
+	}
+	void disconnect(const char* addr, int reason = 0x213) {
+		ble().disconnect(address(addr));
+		ble().on_disconnect(address(addr), reason);
+		server.run_deferred();
+	}
+	std::vector<Sesame::mecha_status_5_t> sent_to(const char* addr) {
+		std::vector<Sesame::mecha_status_5_t> statuses;
+		for (const auto& sent : ble().sent) {
+			if (sent.address == address(addr)) {
+				statuses.push_back(sent.status);
+			}
+		}
+		return statuses;
+	}
+
+	SesameServerComponent server{3, UUID};
+};
+
+TEST_F(SesameServerComponentTest, TriggerAddressFromKey) {
+	auto* trig = new SesameTrigger(&server, 0x0001'cc00'0000'0001);
+	EXPECT_EQ(trig->get_address(), address(TRIGGER_ADDR));
+	EXPECT_EQ(trig->get_address().getType(), BLE_ADDR_RANDOM);
+	delete trig;
+}
+
+TEST_F(SesameServerComponentTest, UnsortedTriggersFailSetup) {
+	add_trigger(OTHER_TRIGGER_ADDR, "open sensor");
+	add_trigger(TRIGGER_ADDR, "remote");
+	server.setup();
+	EXPECT_TRUE(server.is_failed());
+	EXPECT_FALSE(ble().on_command);
+}
+
+TEST_F(SesameServerComponentTest, DuplicatedTriggerAddressFailsSetup) {
+	add_trigger(TRIGGER_ADDR, "remote");
+	add_trigger(TRIGGER_ADDR, "same address");
+	server.setup();
+	EXPECT_TRUE(server.is_failed());
+}
+
+// Computed from the algorithm of __init__.py uuid_to_ints()
+TEST_F(SesameServerComponentTest, UuidAddressKnownAnswer) {
+	auto addr = SesameServer::uuid_to_ble_address(NimBLEUUID{std::string{UUID}});
+	EXPECT_EQ(addr, address("dc:37:61:a1:11:99"));
+	EXPECT_EQ(SesameServer::uuid_to_ble_address(NimBLEUUID{std::string{"12345678-1234-1234-1234-123456789abc"}}),
+	          address("f7:6f:1c:8a:fa:ff"));
+	EXPECT_TRUE(SesameServer::uuid_to_ble_address(NimBLEUUID{std::string{"not a uuid"}}).isNull());
+}
+
+TEST_F(SesameServerComponentTest, UuidCheckPassesSetup) {
+	auto* trig = add_trigger("dc:37:61:a1:11:99", "uuid");
+	server.add_uuid_check(address_key("dc:37:61:a1:11:99"), UUID);
+	start();
+	command("dc:37:61:a1:11:99", item_code_t::lock);
+	server.loop();
+	EXPECT_EQ(trig->triggered, std::vector<std::string>{"lock"});
+}
+
+TEST_F(SesameServerComponentTest, UuidCheckMismatchFailsSetup) {
+	// The address a byte swapped derivation would give
+	add_trigger("d9:11:a1:61:37:5c", "uuid");
+	server.add_uuid_check(address_key("d9:11:a1:61:37:5c"), UUID);
+	server.setup();
+	EXPECT_TRUE(server.is_failed());
+	EXPECT_FALSE(ble().on_command);
+}
+
+TEST_F(SesameServerComponentTest, CommandTriggersEventFromLoop) {
+	auto* trig = add_trigger(TRIGGER_ADDR, "remote");
+	text_sensor::TextSensor tag_sensor;
+	sensor::Sensor type_sensor;
+	sensor::Sensor voltage_sensor;
+	trig->set_history_tag_sensor(&tag_sensor);
+	trig->set_history_tag_type_sensor(&type_sensor);
+	trig->set_scaled_voltage_sensor(&voltage_sensor);
+	start();
+
+	command(TRIGGER_ADDR, item_code_t::lock, "alice", history_tag_type_t::remote_nano, 2.9f);
+	EXPECT_TRUE(trig->triggered.empty());
+	server.loop();
+	EXPECT_EQ(trig->triggered, std::vector<std::string>{"lock"});
+	EXPECT_EQ(trig->get_history_tag(), "alice");
+	EXPECT_EQ(tag_sensor.state, "alice");
+	EXPECT_FLOAT_EQ(type_sensor.state, static_cast<float>(history_tag_type_t::remote_nano));
+	EXPECT_FLOAT_EQ(voltage_sensor.state, 2.9f);
+
+	const auto* history_tag = &trig->get_history_tag();
+	command(TRIGGER_ADDR, item_code_t::unlock, "bob");
+	server.loop();
+	EXPECT_EQ(&trig->get_history_tag(), history_tag);
+	EXPECT_EQ(*history_tag, "bob");
+
+	command(TRIGGER_ADDR, item_code_t::door_open);
+	server.loop();
+	EXPECT_EQ(trig->triggered, (std::vector<std::string>{"lock", "unlock", "open"}));
+	EXPECT_EQ(trig->get_history_tag(), "");
+	EXPECT_TRUE(std::isnan(type_sensor.state));
+}
+
+TEST_F(SesameServerComponentTest, OtherCommandsAndUnlistedDevicesDoNotTrigger) {
+	auto* trig = add_trigger(TRIGGER_ADDR, "remote");
+	start();
+	command(TRIGGER_ADDR, item_code_t::none);
+	command(APP_ADDR, item_code_t::unlock);
+	server.loop();
+	EXPECT_TRUE(trig->triggered.empty());
+}
+
+TEST_F(SesameServerComponentTest, BatteryPercentUsesModelOfHistoryTagType) {
+	auto* trig = add_trigger(TRIGGER_ADDR, "remote");
+	start();
+	auto battery_pct = [&](std::optional<history_tag_type_t> type, float voltage) {
+		command(TRIGGER_ADDR, item_code_t::lock, "", type, voltage);
+		server.loop();
+		return trig->get_battery_pct();
+	};
+	EXPECT_FLOAT_EQ(battery_pct(history_tag_type_t::remote_nano, 2.75f), 50.0f);
+	EXPECT_FLOAT_EQ(battery_pct(history_tag_type_t::open_sensor, 3.0f), 100.0f);
+	EXPECT_FLOAT_EQ(battery_pct(history_tag_type_t::ios_app, 5.5f), 50.0f);
+	EXPECT_TRUE(std::isnan(battery_pct(std::nullopt, 5.5f)));
+	EXPECT_TRUE(std::isnan(battery_pct(history_tag_type_t::ios_app, NAN)));
+}
+
+TEST_F(SesameServerComponentTest, OpenSensor2SwitchState) {
+	auto* trig = add_trigger(TRIGGER_ADDR, "open sensor");
+	binary_sensor::BinarySensor switch_sensor;
+	text_sensor::TextSensor extra_sensor;
+	trig->set_switch_state_sensor(&switch_sensor);
+	trig->set_extra_sensor(&extra_sensor);
+	start();
+	command(TRIGGER_ADDR, item_code_t::door_open, "", history_tag_type_t::open_sensor, 3.0f, std::string_view{"\x5a\x01", 2});
+	server.loop();
+	EXPECT_EQ(trig->get_extra(), "5a01");
+	EXPECT_EQ(extra_sensor.state, "5a01");
+	EXPECT_TRUE(trig->get_extra_info().switch_state.value_or(false));
+	EXPECT_TRUE(switch_sensor.state);
+	// Open Sensor (no switch)
+	command(TRIGGER_ADDR, item_code_t::door_closed, "", history_tag_type_t::open_sensor, 3.0f, std::string_view{"\x5b\xff", 2});
+	server.loop();
+	EXPECT_FALSE(trig->get_extra_info().switch_state.has_value());
+	EXPECT_EQ(switch_sensor.publish_count, 1u);
+}
+
+TEST_F(SesameServerComponentTest, PublishChangesOnly) {
+	auto* trig = add_trigger(TRIGGER_ADDR, "remote");
+	sensor::Sensor voltage_sensor;
+	trig->set_scaled_voltage_sensor(&voltage_sensor);
+	trig->set_publish_changes_only(true);
+	trig->set_voltage_deadband(0.05f);
+	start();
+	for (float voltage : {2.90f, 2.92f, 2.96f}) {
+		command(TRIGGER_ADDR, item_code_t::lock, "", history_tag_type_t::remote_nano, voltage);
+		server.loop();
+	}
+	EXPECT_EQ(voltage_sensor.publish_count, 2u);
+	EXPECT_FLOAT_EQ(voltage_sensor.state, 2.96f);
+}
+
+TEST_F(SesameServerComponentTest, PublishChangesOnlyComparesUnfilteredValues) {
+	auto* trig = add_trigger(TRIGGER_ADDR, "open sensor");
+	sensor::Sensor voltage_sensor;
+	text_sensor::TextSensor extra_sensor;
+	binary_sensor::BinarySensor switch_sensor;
+	voltage_sensor.filter = [](float volts) { return volts * 1000.0f; };
+	extra_sensor.filter = [](const std::string& hex) { return "0x" + hex; };
+	trig->set_scaled_voltage_sensor(&voltage_sensor);
+	trig->set_extra_sensor(&extra_sensor);
+	trig->set_switch_state_sensor(&switch_sensor);
+	trig->set_publish_changes_only(true);
+	start();
+	for (int i = 0; i < 3; i++) {
+		command(TRIGGER_ADDR, item_code_t::door_open, "", history_tag_type_t::open_sensor, 2.9f, std::string_view{"\x5a\x01", 2});
+		server.loop();
+	}
+	EXPECT_EQ(voltage_sensor.publish_count, 1u);
+	EXPECT_FLOAT_EQ(voltage_sensor.state, 2900.0f);
+	EXPECT_EQ(extra_sensor.publish_count, 1u);
+	EXPECT_EQ(extra_sensor.state, "0x5a01");
+	EXPECT_EQ(switch_sensor.publish_count, 1u);
+	command(TRIGGER_ADDR, item_code_t::door_closed, "", history_tag_type_t::open_sensor, 2.9f, std::string_view{"\x5b\x00", 2});
+	server.loop();
+	EXPECT_EQ(voltage_sensor.publish_count, 1u);
+	EXPECT_EQ(extra_sensor.publish_count, 2u);
+	EXPECT_EQ(switch_sensor.publish_count, 2u);
+	EXPECT_FALSE(switch_sensor.state);
+}
+
+TEST_F(SesameServerComponentTest, DuplicateCommandIsSuppressed) {
+	auto* trig = add_trigger(TRIGGER_ADDR, "remote");
+	trig->set_dedup_window(1000);
+	start();
+	command(TRIGGER_ADDR, item_code_t::unlock, "alice");
+	server.loop();
+	server.advance(500);
+	command(TRIGGER_ADDR, item_code_t::unlock, "alice");
+	command(TRIGGER_ADDR, item_code_t::unlock, "bob");
+	server.loop();
+	EXPECT_EQ(trig->triggered, (std::vector<std::string>{"unlock", "unlock"}));
+	EXPECT_EQ(trig->get_suppressed_count(), 1u);
+	server.advance(1000);
+	command(TRIGGER_ADDR, item_code_t::unlock, "bob");
+	server.loop();
+	EXPECT_EQ(trig->triggered.size(), 3u);
+}
+
+TEST_F(SesameServerComponentTest, DuplicateWindowUsesReceiveTime) {
+	auto* trig = add_trigger(TRIGGER_ADDR, "remote");
+	trig->set_dedup_window(1000);
+	start();
+	// Both commands wait in the queue and are processed in the same loop()
+	command(TRIGGER_ADDR, item_code_t::unlock, "alice");
+	server.advance(1500);
+	command(TRIGGER_ADDR, item_code_t::unlock, "alice");
+	server.advance(200);
+	command(TRIGGER_ADDR, item_code_t::unlock, "alice");
+	server.loop();
+	EXPECT_EQ(trig->triggered.size(), 2u);
+	EXPECT_EQ(trig->get_suppressed_count(), 1u);
+}
+
+TEST_F(SesameServerComponentTest, RoutesFireOnMatchingCommands) {
+	auto* trig = add_trigger(TRIGGER_ADDR, "remote");
+	SesameRouteTrigger alice_unlock;
+	SesameRouteTrigger any_lock;
+	trig->add_route(fnv1a_hash("alice"), "alice", event_bit(item_code_t::unlock), -1, &alice_unlock);
+	trig->add_route(0, nullptr, event_bit(item_code_t::lock) | event_bit(item_code_t::unlock), -1, &any_lock);
+	start();
+	command(TRIGGER_ADDR, item_code_t::unlock, "alice");
+	command(TRIGGER_ADDR, item_code_t::unlock, "bob");
+	command(TRIGGER_ADDR, item_code_t::door_open, "alice");
+	server.loop();
+	ASSERT_EQ(alice_unlock.calls.size(), 1u);
+	EXPECT_EQ(std::get<0>(alice_unlock.calls[0]), "unlock");
+	EXPECT_EQ(any_lock.calls.size(), 2u);
+}
+
+TEST_F(SesameServerComponentTest, CommandQueueOverflowIsCounted) {
+	auto* trig = add_trigger(TRIGGER_ADDR, "remote");
+	start();
+	for (size_t i = 0; i < SESAME_SERVER_COMMAND_QUEUE_SIZE + 1; i++) {
+		command(TRIGGER_ADDR, item_code_t::lock);
+	}
+	EXPECT_EQ(server.get_command_overflow_count(), 1u);
+	server.loop();
+	EXPECT_EQ(trig->triggered.size(), SESAME_SERVER_COMMAND_QUEUE_SIZE);
+}
+
+TEST_F(SesameServerComponentTest, EarlyStartHoldsCommandsUntilApiConnects) {
+	api::APIServer api_server;
+	api::global_api_server = &api_server;
+	auto* trig = add_trigger(TRIGGER_ADDR, "remote");
+	server.set_early_start(60 * 1000);
+	start();
+	EXPECT_TRUE(server.is_holding_events());
+	command(TRIGGER_ADDR, item_code_t::lock, "first");
+	server.loop();
+	server.advance(500);
+	command(TRIGGER_ADDR, item_code_t::unlock, "second");
+	server.loop();
+	EXPECT_TRUE(trig->triggered.empty());
+	EXPECT_TRUE(server.is_holding_events());
+
+	api_server.connected = true;
+	server.loop();
+	EXPECT_FALSE(server.is_holding_events());
+	EXPECT_FALSE(server.has_timer("event_hold"));
+	EXPECT_EQ(trig->triggered, (std::vector<std::string>{"lock", "unlock"}));
+	EXPECT_EQ(trig->get_history_tag(), "second");
+	command(TRIGGER_ADDR, item_code_t::lock);
+	server.loop();
+	EXPECT_EQ(trig->triggered.size(), 3u);
+}
+
+TEST_F(SesameServerComponentTest, EarlyStartReleasesOnTimeout) {
+	api::APIServer api_server;
+	api::global_api_server = &api_server;
+	auto* trig = add_trigger(TRIGGER_ADDR, "remote");
+	server.set_early_start(10 * 1000);
+	start();
+	command(TRIGGER_ADDR, item_code_t::lock);
+	server.advance(10 * 1000 - 1);
+	server.loop();
+	EXPECT_TRUE(trig->triggered.empty());
+	server.advance(1);
+	server.loop();
+	EXPECT_FALSE(server.is_holding_events());
+	EXPECT_EQ(trig->triggered, std::vector<std::string>{"lock"});
+}
+
+TEST_F(SesameServerComponentTest, EarlyStartCountsOverflowWhileHolding) {
+	api::APIServer api_server;
+	api::global_api_server = &api_server;
+	auto* trig = add_trigger(TRIGGER_ADDR, "remote");
+	server.set_event_history_size(16);
+	server.set_early_start(60 * 1000);
+	start();
+	for (size_t i = 0; i < SESAME_SERVER_COMMAND_QUEUE_SIZE + 2; i++) {
+		command(TRIGGER_ADDR, i % 2 ? item_code_t::unlock : item_code_t::lock, std::to_string(i));
+		server.loop();
+	}
+	EXPECT_EQ(server.get_command_overflow_count(), 2u);
+	EXPECT_TRUE(trig->triggered.empty());
+
+	api_server.connected = true;
+	server.loop();
+	// The oldest commands are kept, in the order received
+	const auto& history = server.get_event_history();
+	ASSERT_EQ(history.size(), SESAME_SERVER_COMMAND_QUEUE_SIZE);
+	for (size_t i = 0; i < history.size(); i++) {
+		EXPECT_EQ(history.at(i).get_tag(), std::to_string(i));
+	}
+	EXPECT_EQ(trig->triggered.size(), SESAME_SERVER_COMMAND_QUEUE_SIZE);
+}
+
+TEST_F(SesameServerComponentTest, HeldCommandsAreLeftOutOfLatencyHistograms) {
+	api::APIServer api_server;
+	api::global_api_server = &api_server;
+	sensor::Sensor latency_max;
+	server.set_latency_max_sensor(&latency_max);
+	server.set_diagnostics_interval(1000);
+	auto* trig = add_trigger(TRIGGER_ADDR, "remote");
+	server.set_early_start(60 * 1000);
+	start();
+	command(TRIGGER_ADDR, item_code_t::lock);
+	server.advance(2000);
+	api_server.connected = true;
+	server.loop();
+	ASSERT_EQ(trig->triggered.size(), 1u);
+	// The last latency still shows the time held
+	EXPECT_GE(trig->get_last_latency().queue_us, 2000u * 1000);
+	EXPECT_EQ(trig->get_latency_histogram().get_count(), 0u);
+	server.advance(1000);
+	EXPECT_EQ(latency_max.publish_count, 0u);
+
+	command(TRIGGER_ADDR, item_code_t::unlock);
+	server.loop();
+	EXPECT_EQ(trig->get_latency_histogram().get_count(), 1u);
+	server.advance(1000);
+	ASSERT_EQ(latency_max.publish_count, 1u);
+	EXPECT_LT(latency_max.state, 1.0f);
+}
+
+TEST_F(SesameServerComponentTest, ServerLatencyHistogramMergesTriggers) {
+	auto* trig = add_trigger(TRIGGER_ADDR, "remote");
+	auto* other = add_trigger(OTHER_TRIGGER_ADDR, "touch");
+	start();
+	command(TRIGGER_ADDR, item_code_t::lock);
+	test::advance_us(300);
+	server.loop();
+	command(OTHER_TRIGGER_ADDR, item_code_t::unlock);
+	test::advance_us(5000);
+	server.loop();
+	ASSERT_EQ(trig->get_latency_histogram().get_count(), 1u);
+	ASSERT_EQ(other->get_latency_histogram().get_count(), 1u);
+
+	auto merged = server.get_latency_histogram();
+	EXPECT_EQ(merged.get_count(), 2u);
+	EXPECT_EQ(merged.get_max(), other->get_latency_histogram().get_max());
+	EXPECT_GE(merged.get_max(), 5000u);
+	for (size_t i = 0; i < LatencyHistogram::BUCKETS; i++) {
+		EXPECT_EQ(merged.get_bucket_count(i),
+		          trig->get_latency_histogram().get_bucket_count(i) + other->get_latency_histogram().get_bucket_count(i));
+	}
+}
+
+TEST_F(SesameServerComponentTest, ConnectCheckPolicy) {
+	// Packed as (type << 48) | address and sorted, as generated by codegen
+	static constexpr SesameServerConnectCheckEntry checks[] = {
+	    {0x0001'cc00'0000'0001, connect_check_policy_t::allow},
+	    {0x0001'cc00'0000'0002, connect_check_policy_t::deny},
+	};
+	server.set_connect_checks(checks, connect_check_policy_t::deny);
+	start();
+	EXPECT_TRUE(connect_check(TRIGGER_ADDR));
+	EXPECT_FALSE(connect_check(OTHER_TRIGGER_ADDR));
+	EXPECT_FALSE(connect_check(APP_ADDR));
+	EXPECT_EQ(server.get_connect_allowed_count(), 1u);
+	EXPECT_EQ(server.get_connect_denied_count(), 2u);
+}
+
+TEST_F(SesameServerComponentTest, ReservedSessionsAdmitTriggersOnly) {
+	add_trigger(TRIGGER_ADDR, "remote");
+	server.set_reserved_trigger_sessions(1);
+	start();
+	connect(APP_ADDR);
+	connect(APP2_ADDR);
+	EXPECT_FALSE(connect_check("dd:00:00:00:00:03"));
+	EXPECT_TRUE(connect_check(TRIGGER_ADDR));
+	EXPECT_EQ(server.get_session_stats().sessions, 2u);
+}
+
+TEST_F(SesameServerComponentTest, AdvertisingPausesWhenFull) {
+	server.set_advertising_profile(100, 30 * 1000, 1000, true);
+	start();
+	EXPECT_EQ(server.get_advertising_mode(), advertising_mode_t::fast);
+	connect(APP_ADDR);
+	connect(APP2_ADDR);
+	connect("dd:00:00:00:00:03");
+	EXPECT_EQ(server.get_advertising_mode(), advertising_mode_t::paused);
+	EXPECT_FALSE(ble().advertising);
+	disconnect(APP2_ADDR);
+	EXPECT_EQ(server.get_advertising_mode(), advertising_mode_t::fast);
+	EXPECT_TRUE(ble().advertising);
+}
+
+TEST_F(SesameServerComponentTest, AdvertisingContinuesWhileUnlistedSessionsAreEvictable) {
+	add_trigger(TRIGGER_ADDR, "remote");
+	server.set_advertising_profile(100, 30 * 1000, 1000, true);
+	start();
+	connect(APP_ADDR);
+	connect(APP2_ADDR);
+	connect("dd:00:00:00:00:03");
+	EXPECT_EQ(server.get_advertising_mode(), advertising_mode_t::fast);
+	// The trigger makes room by evicting the least recently used idle unlisted session
+	server.advance(10);
+	EXPECT_TRUE(connect_check(TRIGGER_ADDR));
+	server.loop();
+	EXPECT_TRUE(ble().disconnected.empty());
+	server.advance(5000);
+	EXPECT_TRUE(connect_check(TRIGGER_ADDR));
+	server.loop();
+	ASSERT_EQ(ble().disconnected.size(), 1u);
+	EXPECT_EQ(ble().disconnected[0], address(APP_ADDR));
+}
+
+TEST_F(SesameServerComponentTest, EvictionIdleIsConfigurable) {
+	add_trigger(TRIGGER_ADDR, "remote");
+	server.set_unlisted_eviction_idle(2000);
+	start();
+	connect(APP_ADDR);
+	connect(APP2_ADDR);
+	connect("dd:00:00:00:00:03");
+	server.advance(1999);
+	EXPECT_TRUE(connect_check(TRIGGER_ADDR));
+	server.loop();
+	EXPECT_TRUE(ble().disconnected.empty());
+	server.advance(1);
+	EXPECT_TRUE(connect_check(TRIGGER_ADDR));
+	server.loop();
+	ASSERT_EQ(ble().disconnected.size(), 1u);
+	EXPECT_EQ(ble().disconnected[0], address(APP_ADDR));
+}
+
+TEST_F(SesameServerComponentTest, UnlistedSessionIsDisconnectedAfterIdleTimeout) {
+	add_trigger(TRIGGER_ADDR, "remote");
+	server.set_unlisted_idle_timeout(20 * 1000);
+	start();
+	connect(APP_ADDR);
+	connect(APP2_ADDR);
+	connect(TRIGGER_ADDR);
+	server.advance(10 * 1000);
+	command(APP2_ADDR, item_code_t::lock);
+	server.loop();
+	server.advance(10 * 1000 - 1);
+	EXPECT_TRUE(ble().disconnected.empty());
+	// Checked every quarter of the timeout, triggers are never disconnected
+	server.advance(1);
+	EXPECT_EQ(ble().disconnected, std::vector<NimBLEAddress>{address(APP_ADDR)});
+	server.advance(10 * 1000 - 1);
+	EXPECT_EQ(ble().disconnected.size(), 1u);
+	server.advance(1);
+	EXPECT_EQ(ble().disconnected, (std::vector<NimBLEAddress>{address(APP_ADDR), address(APP2_ADDR)}));
+	server.advance(60 * 1000);
+	EXPECT_EQ(ble().disconnected.size(), 2u);
+}
+
+TEST_F(SesameServerComponentTest, TriggerTakingTheLastSlotDoesNotEvict) {
+	add_trigger(TRIGGER_ADDR, "remote");
+	start();
+	connect(APP_ADDR);
+	connect(APP2_ADDR);
+	server.advance(10 * 1000);
+	connect(TRIGGER_ADDR);
+	server.loop();
+	EXPECT_TRUE(ble().disconnected.empty());
+	EXPECT_EQ(server.get_session_stats().sessions, 3u);
+}
+
+TEST_F(SesameServerComponentTest, TriggerConnectionSendsCurrentLockState) {
+	auto* trig = add_trigger(TRIGGER_ADDR, "remote");
+	auto* connection = new binary_sensor::BinarySensor;
+	trig->set_connection_sensor(connection);
+	lock::Lock lock;
+	lock.state = lock::LOCK_STATE_LOCKED;
+	server.set_lock_entity(&lock);
+	start();
+
+	connect(TRIGGER_ADDR);
+	EXPECT_TRUE(trig->is_connected());
+	EXPECT_TRUE(connection->state);
+	EXPECT_EQ(trig->get_connect_count(), 1u);
+	auto sent = sent_to(TRIGGER_ADDR);
+	ASSERT_EQ(sent.size(), 1u);
+	EXPECT_TRUE(sent[0].in_lock);
+	EXPECT_EQ(server.get_session_stats().authentications, 1u);
+	EXPECT_EQ(server.get_session_stats().sessions, 1u);
+
+	disconnect(TRIGGER_ADDR);
+	EXPECT_FALSE(trig->is_connected());
+	EXPECT_FALSE(connection->state);
+	auto stats = server.get_session_stats();
+	EXPECT_EQ(stats.sessions, 0u);
+	EXPECT_EQ(stats.disconnects_by_reason[static_cast<size_t>(disconnect_reason_t::remote_terminated)], 1u);
+}
+
+TEST_F(SesameServerComponentTest, LockStateCoalesceSendsLastStateOfWindow) {
+	add_trigger(TRIGGER_ADDR, "remote");
+	lock::Lock lock;
+	lock.state = lock::LOCK_STATE_UNLOCKED;
+	server.set_lock_entity(&lock);
+	server.set_lock_state_coalesce(100);
+	start();
+	connect(TRIGGER_ADDR);
+	ASSERT_EQ(ble().sent.size(), 1u);
+
+	// LOCKING then LOCKED within the window is one notification of LOCKED, at the end of the window
+	lock.publish_state(lock::LOCK_STATE_LOCKING);
+	server.advance(60);
+	lock.publish_state(lock::LOCK_STATE_LOCKED);
+	server.advance(39);
+	EXPECT_EQ(ble().sent.size(), 1u);
+	server.advance(1);
+	ASSERT_EQ(ble().sent.size(), 2u);
+	EXPECT_TRUE(ble().sent[1].status.in_lock);
+
+	// A state after the window is delivered in its own window
+	server.advance(500);
+	EXPECT_EQ(ble().sent.size(), 2u);
+	lock.publish_state(lock::LOCK_STATE_UNLOCKED);
+	server.advance(100);
+	ASSERT_EQ(ble().sent.size(), 3u);
+	EXPECT_TRUE(ble().sent[2].status.in_unlock);
+	EXPECT_FALSE(server.has_timer("lock_state"));
+}
+
+TEST_F(SesameServerComponentTest, ConnectionProfilesRequestParameters) {
+	struct {
+		const char* addr;
+		connection_profile_t profile;
+		uint16_t min_interval, max_interval, latency, timeout;
+	} cases[] = {
+	    {"cc:00:00:00:00:01", connection_profile_t::low_latency, 6, 12, 0, 200},
+	    {"cc:00:00:00:00:02", connection_profile_t::balanced, 24, 40, 0, 400},
+	    {"cc:00:00:00:00:03", connection_profile_t::low_power, 80, 160, 4, 600},
+	};
+	auto& peers = NimBLEDevice::getServer()->peers;
+	for (const auto& c : cases) {
+		add_trigger(c.addr, "remote")->set_connection_profile(c.profile);
+		// Handles are the positions in peers, listed in reverse to tell them apart from the trigger order
+		peers.insert(peers.begin(), address(c.addr));
+	}
+	start();
+	const auto& conn_params = NimBLEDevice::getServer()->conn_params;
+	for (const auto& c : cases) {
+		connect(c.addr);
+		ASSERT_FALSE(conn_params.empty());
+		const auto& params = conn_params.back();
+		EXPECT_EQ(params.handle, NimBLEDevice::getServer()->getPeerInfo(address(c.addr)).getConnHandle());
+		EXPECT_EQ(params.min_interval, c.min_interval);
+		EXPECT_EQ(params.max_interval, c.max_interval);
+		EXPECT_EQ(params.latency, c.latency);
+		EXPECT_EQ(params.timeout, c.timeout);
+		disconnect(c.addr);
+	}
+	EXPECT_EQ(conn_params.size(), std::size(cases));
+	auto stats = server.get_session_stats();
+	EXPECT_EQ(stats.connection_profiles[static_cast<size_t>(connection_profile_t::low_latency)], 1u);
+	EXPECT_EQ(stats.connection_profiles[static_cast<size_t>(connection_profile_t::balanced)], 1u);
+	EXPECT_EQ(stats.connection_profiles[static_cast<size_t>(connection_profile_t::low_power)], 1u);
+}
+
+TEST_F(SesameServerComponentTest, ConnectionProfileLeavesOtherPeersUntouched) {
+	add_trigger(TRIGGER_ADDR, "remote")->set_connection_profile(connection_profile_t::low_latency);
+	add_trigger(OTHER_TRIGGER_ADDR, "no profile");
+	// APP_ADDR holds a BLE connection but never authenticates
+	NimBLEDevice::getServer()->peers = {address(APP_ADDR), address(OTHER_TRIGGER_ADDR), address(APP2_ADDR),
+	                                    address(TRIGGER_ADDR)};
+	start();
+	const auto& conn_params = NimBLEDevice::getServer()->conn_params;
+	connect(OTHER_TRIGGER_ADDR);
+	connect(APP2_ADDR);
+	EXPECT_TRUE(conn_params.empty());
+	connect(TRIGGER_ADDR);
+	ASSERT_EQ(conn_params.size(), 1u);
+	EXPECT_EQ(conn_params[0].handle, 3u);
+
+	// Unlisted devices get their own profile, and a session without a connection gets none
+	disconnect(APP2_ADDR);
+	disconnect(OTHER_TRIGGER_ADDR);
+	server.set_unlisted_connection_profile(connection_profile_t::low_power);
+	connect(APP2_ADDR);
+	ASSERT_EQ(conn_params.size(), 2u);
+	EXPECT_EQ(conn_params[1].handle, 2u);
+	EXPECT_EQ(conn_params[1].min_interval, 80u);
+	connect("dd:00:00:00:00:03");
+	EXPECT_EQ(conn_params.size(), 2u);
+	EXPECT_EQ(server.get_session_stats().connection_profile_failures, 1u);
+	for (const auto& params : conn_params) {
+		EXPECT_NE(params.handle, 0u);
+	}
+}
+
+TEST_F(SesameServerComponentTest, UnlistedSessionReceivesLockState) {
+	lock::Lock lock;
+	lock.state = lock::LOCK_STATE_UNLOCKED;
+	server.set_lock_entity(&lock);
+	start();
+	connect(APP_ADDR);
+	auto sent = sent_to(APP_ADDR);
+	ASSERT_EQ(sent.size(), 1u);
+	EXPECT_TRUE(sent[0].in_unlock);
+
+	lock.publish_state(lock::LOCK_STATE_LOCKED);
+	sent = sent_to(APP_ADDR);
+	ASSERT_EQ(sent.size(), 2u);
+	EXPECT_TRUE(sent[1].in_lock);
+	EXPECT_TRUE(ble().mecha_status->in_lock);
+}
+
+TEST_F(SesameServerComponentTest, RedundantLockStateIsSkipped) {
+	add_trigger(TRIGGER_ADDR, "remote");
+	lock::Lock lock;
+	lock.state = lock::LOCK_STATE_LOCKED;
+	server.set_lock_entity(&lock);
+	start();
+	connect(TRIGGER_ADDR);
+	lock.publish_state(lock::LOCK_STATE_LOCKED);
+	EXPECT_EQ(sent_to(TRIGGER_ADDR).size(), 1u);
+	EXPECT_EQ(server.get_lock_state_skipped_count(), 1u);
+	lock.publish_state(lock::LOCK_STATE_UNLOCKING);
+	EXPECT_EQ(sent_to(TRIGGER_ADDR).size(), 2u);
+}
+
+TEST_F(SesameServerComponentTest, TriggerLockEntityTakesPrecedence) {
+	auto* trig = add_trigger(TRIGGER_ADDR, "remote");
+	lock::Lock server_lock;
+	lock::Lock trigger_lock;
+	server_lock.state = lock::LOCK_STATE_LOCKED;
+	trigger_lock.state = lock::LOCK_STATE_UNLOCKED;
+	server.set_lock_entity(&server_lock);
+	trig->set_lock_entity(&trigger_lock);
+	start();
+	connect(TRIGGER_ADDR);
+	ASSERT_EQ(sent_to(TRIGGER_ADDR).size(), 1u);
+	EXPECT_TRUE(sent_to(TRIGGER_ADDR)[0].in_unlock);
+	server_lock.publish_state(lock::LOCK_STATE_UNLOCKED);
+	server_lock.publish_state(lock::LOCK_STATE_LOCKED);
+	EXPECT_EQ(sent_to(TRIGGER_ADDR).size(), 1u);
+}
+
+TEST_F(SesameServerComponentTest, FailedLockStateIsRetried) {
+	add_trigger(TRIGGER_ADDR, "remote");
+	lock::Lock lock;
+	lock.state = lock::LOCK_STATE_LOCKED;
+	server.set_lock_entity(&lock);
+	server.set_lock_state_retry(3, 250, 1000);
+	start();
+	connect(TRIGGER_ADDR);
+	ble().send_failures = 2;
+	lock.publish_state(lock::LOCK_STATE_UNLOCKED);
+	EXPECT_EQ(sent_to(TRIGGER_ADDR).size(), 1u);
+	server.advance(250);  // first retry fails, backoff 500ms
+	EXPECT_EQ(sent_to(TRIGGER_ADDR).size(), 1u);
+	server.advance(500);
+	ASSERT_EQ(sent_to(TRIGGER_ADDR).size(), 2u);
+	EXPECT_TRUE(sent_to(TRIGGER_ADDR)[1].in_unlock);
+	const auto& stats = server.get_lock_state_retry_stats();
+	EXPECT_EQ(stats.retries, 2u);
+	EXPECT_EQ(stats.redelivered, 1u);
+	EXPECT_EQ(stats.last_redelivery_ms, 750u);
+	EXPECT_EQ(stats.failures, 0u);
+}
+
+TEST_F(SesameServerComponentTest, SupersedingLockStateIsNotCountedAsRedelivered) {
+	add_trigger(TRIGGER_ADDR, "remote");
+	lock::Lock lock;
+	lock.state = lock::LOCK_STATE_LOCKED;
+	server.set_lock_entity(&lock);
+	server.set_lock_state_retry(3, 250, 1000);
+	start();
+	connect(TRIGGER_ADDR);
+	ble().send_failures = 1;
+	lock.publish_state(lock::LOCK_STATE_UNLOCKED);
+	lock.publish_state(lock::LOCK_STATE_LOCKED);
+	ASSERT_EQ(sent_to(TRIGGER_ADDR).size(), 2u);
+	EXPECT_FALSE(sent_to(TRIGGER_ADDR)[1].in_unlock);
+	server.advance(1000);
+	EXPECT_EQ(sent_to(TRIGGER_ADDR).size(), 2u);
+	const auto& stats = server.get_lock_state_retry_stats();
+	EXPECT_EQ(stats.superseded, 1u);
+	EXPECT_EQ(stats.redelivered, 0u);
+	EXPECT_EQ(stats.retries, 0u);
+}
+
+TEST_F(SesameServerComponentTest, TraceKeepsTagsWithoutAddingToTagTable) {
+	add_trigger(TRIGGER_ADDR, "remote");
+	server.set_trace_size(8);
+	start();
+	command(APP_ADDR, item_code_t::lock, "unlisted");
+	server.loop();
+	EXPECT_EQ(server.get_tag_table().size(), 0u);
+	command(TRIGGER_ADDR, item_code_t::lock, "listed");
+	server.loop();
+	command(TRIGGER_ADDR, item_code_t::unlock, "listed");
+	server.loop();
+	EXPECT_EQ(server.get_tag_table().size(), 1u);
+	const auto& trace = server.get_trace();
+	ASSERT_EQ(trace.size(), 3u);
+	EXPECT_EQ(trace.at(0).get_tag(), "unlisted");
+	EXPECT_EQ(trace.at(1).get_tag(), "listed");
+	EXPECT_EQ(trace.at(2).get_tag(), "listed");
+
+	// Tags are kept after the tag table is full
+	for (size_t i = 0; i < SESAME_SERVER_TAG_TABLE_SIZE + 1; i++) {
+		command(TRIGGER_ADDR, item_code_t::lock, "tag" + std::to_string(i));
+		server.loop();
+	}
+	EXPECT_EQ(trace.at(trace.size() - 1).get_tag(), "tag" + std::to_string(SESAME_SERVER_TAG_TABLE_SIZE));
+	server.dump_trace();
+}
+
+TEST_F(SesameServerComponentTest, RegistrationSecretIsRestored) {
+	ble().registered = false;
+	start();
+	SesameServer::secret_t secret{};
+	secret[0] = std::byte{0x42};
+	ble().on_registration(address(APP_ADDR), secret);
+
+	SesameServerComponent restored{3, UUID};
+	restored.setup();
+	EXPECT_FALSE(restored.is_failed());
+	EXPECT_TRUE(SesameServer::last_instance->registered);
+	EXPECT_EQ(SesameServer::last_instance->secret, secret);
+}
+
+TEST_F(SesameServerComponentTest, RegistrationSecretKeepsFixedPreferenceKey) {
+	// Secrets saved by earlier versions must keep being found under the same key
+	SesameServer::secret_t secret{};
+	secret[0] = std::byte{0x24};
+	auto pref = global_preferences->make_preference<SesameServer::secret_t>(0x76d18970);
+	ASSERT_TRUE(pref.save(&secret));
+
+	ble().registered = false;
+	start();
+	EXPECT_TRUE(SesameServer::last_instance->registered);
+	EXPECT_EQ(SesameServer::last_instance->secret, secret);
+}
+
+TEST_F(SesameServerComponentTest, EventDrivenLoopSleepsWhenIdle) {
+	auto* trig = add_trigger(TRIGGER_ADDR, "remote");
+	server.set_event_driven_loop(true);
+	start();
+	server.loop();
+	EXPECT_FALSE(server.is_loop_enabled());
+	EXPECT_EQ(server.get_loop_stats().sleeps, 1u);
+
+	command(TRIGGER_ADDR, item_code_t::lock);
+	EXPECT_TRUE(server.is_loop_enabled());
+	server.loop();
+	EXPECT_EQ(trig->triggered.size(), 1u);
+	EXPECT_EQ(server.get_loop_stats().wakeups, 1u);
+	EXPECT_FALSE(server.is_loop_enabled());
+
+	connect(TRIGGER_ADDR);
+	server.loop();
+	EXPECT_TRUE(server.is_loop_enabled());
+	EXPECT_FALSE(HighFrequencyLoopRequester::is_high_frequency());
+	disconnect(TRIGGER_ADDR);
+	server.loop();
+	EXPECT_FALSE(server.is_loop_enabled());
+}
+
+TEST_F(SesameServerComponentTest, AggregateEventDefersSensors) {
+	auto* trig = add_trigger(TRIGGER_ADDR, "remote");
+	sensor::Sensor voltage_sensor;
+	trig->set_scaled_voltage_sensor(&voltage_sensor);
+	trig->set_aggregate_event(true);
+	server.set_aggregate_sensor_interval(10 * 1000);
+	start();
+	command(TRIGGER_ADDR, item_code_t::lock, "", history_tag_type_t::remote_nano, 2.9f);
+	command(TRIGGER_ADDR, item_code_t::unlock, "", history_tag_type_t::remote_nano, 2.8f);
+	server.loop();
+	EXPECT_EQ(trig->triggered.size(), 2u);
+	EXPECT_EQ(voltage_sensor.publish_count, 0u);
+	// Each activation carries its values in an event instead
+	const auto& events = server.get_aggregate_event_api()->events;
+	ASSERT_EQ(events.size(), 2u);
+	EXPECT_EQ(events[0].name, "esphome.sesame_server_trigger");
+	EXPECT_EQ(events[0].data.at("trigger"), "remote");
+	EXPECT_EQ(events[0].data.at("event_type"), "lock");
+	EXPECT_FLOAT_EQ(std::stof(events[0].data.at("scaled_voltage")), 2.9f);
+	EXPECT_EQ(events[1].data.at("event_type"), "unlock");
+	EXPECT_FLOAT_EQ(std::stof(events[1].data.at("scaled_voltage")), 2.8f);
+	server.advance(10 * 1000);
+	EXPECT_EQ(voltage_sensor.publish_count, 1u);
+	EXPECT_FLOAT_EQ(voltage_sensor.state, 2.8f);
+}
+
+TEST_F(SesameServerComponentTest, EventHistoryKeepsLatestEvents) {
+	add_trigger(TRIGGER_ADDR, "remote");
+	add_trigger(OTHER_TRIGGER_ADDR, "open sensor");
+	server.set_event_history_size(2);
+	start();
+	command(TRIGGER_ADDR, item_code_t::lock, "alice");
+	command(OTHER_TRIGGER_ADDR, item_code_t::door_open);
+	command(TRIGGER_ADDR, item_code_t::unlock, "bob");
+	server.loop();
+	const auto& history = server.get_event_history();
+	ASSERT_EQ(history.size(), 2u);
+	EXPECT_EQ(server.get_event_history_seq(), 3u);
+	EXPECT_EQ(history.at(0).seq, 2u);
+	EXPECT_EQ(history.at(0).trigger_index, 1u);
+	EXPECT_EQ(history.at(1).trigger_index, 0u);
+	EXPECT_EQ(history.at(1).item_code, static_cast<uint8_t>(item_code_t::unlock));
+	EXPECT_EQ(history.at(1).get_tag(), "bob");
+}
+
+TEST_F(SesameServerComponentTest, EventHistoryKeepsTagsAfterTagTableIsFull) {
+	add_trigger(TRIGGER_ADDR, "remote");
+	server.set_event_history_size(4);
+	start();
+	for (size_t i = 0; i < SESAME_SERVER_TAG_TABLE_SIZE + 2; i++) {
+		command(TRIGGER_ADDR, item_code_t::lock, "tag" + std::to_string(i));
+		server.loop();
+	}
+	EXPECT_EQ(server.get_tag_table().find("tag" + std::to_string(SESAME_SERVER_TAG_TABLE_SIZE)), TagTable::NO_TAG);
+	const auto& history = server.get_event_history();
+	ASSERT_EQ(history.size(), 4u);
+	EXPECT_EQ(history.at(2).get_tag(), "tag" + std::to_string(SESAME_SERVER_TAG_TABLE_SIZE));
+	EXPECT_EQ(history.at(3).get_tag(), "tag" + std::to_string(SESAME_SERVER_TAG_TABLE_SIZE + 1));
+}
+
+TEST_F(SesameServerComponentTest, EventHistoryKeepsReceiveTime) {
+	add_trigger(TRIGGER_ADDR, "remote");
+	server.set_event_history_size(4);
+	start();
+	auto received_ms = millis();
+	command(TRIGGER_ADDR, item_code_t::lock);
+	test::advance_us(40000);
+	server.loop();
+	const auto& history = server.get_event_history();
+	ASSERT_EQ(history.size(), 1u);
+	EXPECT_EQ(history.at(0).time_ms, received_ms);
+}
+
+TEST_F(SesameServerComponentTest, ClientWindowWaitsForIdleSessions) {
+	add_trigger(TRIGGER_ADDR, "remote");
+	add_trigger(OTHER_TRIGGER_ADDR, "open sensor");
+	server.set_client_window_timing(2000, 30000);
+	start();
+	server.advance(5000);
+	int granted = 0;
+	server.request_client_window(address(TRIGGER_ADDR), 20000, [&granted]() { granted++; });
+	EXPECT_EQ(granted, 1);
+	server.release_client_window();
+
+	// A command of another trigger delays the window as well
+	command(OTHER_TRIGGER_ADDR, item_code_t::door_open);
+	server.loop();
+	server.request_client_window(address(TRIGGER_ADDR), 20000, [&granted]() { granted++; });
+	EXPECT_EQ(granted, 1);
+	server.advance(1500);
+	EXPECT_EQ(granted, 1);
+	server.advance(750);
+	EXPECT_EQ(granted, 2);
+	EXPECT_EQ(server.get_client_window_stats().forced, 0u);
+	server.release_client_window();
+}
+
+TEST_F(SesameServerComponentTest, ClientWindowIsForcedAfterMaxWait) {
+	add_trigger(TRIGGER_ADDR, "remote");
+	add_trigger(OTHER_TRIGGER_ADDR, "open sensor");
+	server.set_client_window_timing(2000, 5000);
+	start();
+	int granted = 0;
+	command(OTHER_TRIGGER_ADDR, item_code_t::door_open);
+	server.loop();
+	server.request_client_window(address(TRIGGER_ADDR), 20000, [&granted]() { granted++; });
+	for (int i = 0; i < 5; i++) {
+		server.advance(1000);
+		command(OTHER_TRIGGER_ADDR, item_code_t::door_closed);
+		server.loop();
+	}
+	server.advance(250);
+	EXPECT_EQ(granted, 1);
+	EXPECT_EQ(server.get_client_window_stats().forced, 1u);
+	server.release_client_window();
+}
+
+}  // namespace
+}  // namespace esphome::sesame_server
@@ -0,0 +1,89 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+#include "tag_table.h"
+
+namespace esphome::sesame_server {
+namespace {
+
+constexpr const char UUID[] = "0123abcd-4567-89ef-0123-456789abcdef";
+
+TEST(TagTableTest, EmptyTagIsNoTag) {
+	TagTable table{4};
+	EXPECT_EQ(table.intern(""), TagTable::NO_TAG);
+	EXPECT_EQ(table.find(""), TagTable::NO_TAG);
+	EXPECT_EQ(table.size(), 0u);
+	EXPECT_EQ(table.to_string(TagTable::NO_TAG), "");
+}
+
+TEST(TagTableTest, InternReturnsStableIds) {
+	TagTable table{4};
+	auto alice = table.intern("alice");
+	auto bob = table.intern("bob");
+	EXPECT_NE(alice, TagTable::NO_TAG);
+	EXPECT_NE(alice, bob);
+	EXPECT_EQ(table.intern("alice"), alice);
+	EXPECT_EQ(table.find("bob"), bob);
+	EXPECT_EQ(table.to_string(alice), "alice");
+	EXPECT_EQ(table.size(), 2u);
+}
+
+TEST(TagTableTest, FindDoesNotAdd) {
+	TagTable table{4};
+	EXPECT_EQ(table.find("carol"), TagTable::NO_TAG);
+	EXPECT_EQ(table.size(), 0u);
+}
+
+TEST(TagTableTest, UuidTagsAreStoredBinary) {
+	TagTable table{4};
+	auto id = table.intern(UUID);
+	ASSERT_NE(id, TagTable::NO_TAG);
+	auto uuid = table.get_uuid(id);
+	ASSERT_TRUE(uuid.has_value());
+	EXPECT_EQ(std::to_integer<uint8_t>((*uuid)[0]), 0x01);
+	EXPECT_EQ(std::to_integer<uint8_t>((*uuid)[15]), 0xef);
+	EXPECT_EQ(table.to_string(id), UUID);
+	EXPECT_EQ(table.find(UUID), id);
+	EXPECT_FALSE(table.get_uuid(table.intern("alice")).has_value());
+}
+
+TEST(TagTableTest, UppercaseUuidIsKeptAsString) {
+	TagTable table{4};
+	constexpr const char upper[] = "0123ABCD-4567-89EF-0123-456789ABCDEF";
+	EXPECT_FALSE(TagTable::parse_uuid(upper).has_value());
+	auto id = table.intern(upper);
+	EXPECT_FALSE(table.get_uuid(id).has_value());
+	EXPECT_EQ(table.to_string(id), upper);
+	EXPECT_NE(table.intern(UUID), id);
+}
+
+TEST(TagTableTest, FullTableReturnsNoTag) {
+	TagTable table{2};
+	table.intern("a");
+	table.intern("b");
+	EXPECT_TRUE(table.full());
+	EXPECT_EQ(table.intern("c"), TagTable::NO_TAG);
+	EXPECT_NE(table.intern("a"), TagTable::NO_TAG);
+	EXPECT_EQ(table.size(), 2u);
+}
+
+TEST(TagTableTest, ManyTagsStayDistinct) {
+	TagTable table{64};
+	std::vector<tag_id_t> ids;
+	for (int i = 0; i < 64; i++) {
+		ids.push_back(table.intern("tag" + std::to_string(i)));
+	}
+	for (int i = 0; i < 64; i++) {
+		EXPECT_EQ(table.find("tag" + std::to_string(i)), ids[i]);
+		EXPECT_EQ(table.to_string(ids[i]), "tag" + std::to_string(i));
+	}
+}
+
+TEST(TagTableTest, UnknownIdsAreEmpty) {
+	TagTable table{2};
+	EXPECT_EQ(table.to_string(5), "");
+	EXPECT_FALSE(table.get_uuid(5).has_value());
+}
+
+}  // namespace
+}  // namespace esphome::sesame_server
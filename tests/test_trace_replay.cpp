@@ -0,0 +1,169 @@
+#include <gtest/gtest.h>
+#include <cmath>
+#include <string>
+#include <vector>
+#include "esphome/core/log.h"
+#include "trace_replay.h"
+
+namespace esphome::sesame_server::replay {
+namespace {
+
+using libsesame3bt::history_tag_type_t;
+using libsesame3bt::Sesame;
+using libsesame3bt::SesameServer;
+using item_code_t = Sesame::item_code_t;
+
+constexpr const char UUID[] = "6ab3d2ca-7b5e-4c38-b5c4-2a1bd26f9d01";
+constexpr uint64_t TRIGGER_KEY = 0x0001'cc00'0000'0001;
+constexpr const char TRIGGER_ADDR[] = "cc:00:00:00:00:01";
+constexpr const char APP_ADDR[] = "dd:00:00:00:00:01";
+
+NimBLEAddress
+address(const char* str) {
+	return NimBLEAddress{std::string{str}, BLE_ADDR_RANDOM};
+}
+
+class TraceReplayTest : public ::testing::Test {
+ protected:
+	void SetUp() override {
+		test::set_now_us(1000 * 1000 * 1000);
+		global_preferences->slots.clear();
+		NimBLEDevice::getServer()->peers.clear();
+	}
+	void TearDown() override { test::set_log_sink(nullptr); }
+	// Sets up a component with one trigger and tracing, returns its stand-in server
+	static SesameServer& start(SesameServerComponent& server, SesameTrigger*& trig) {
+		trig = new SesameTrigger(&server, TRIGGER_KEY);
+		trig->set_name("remote");
+		server.add_trigger(trig);
+		server.set_trace_size(32);
+		server.setup();
+		EXPECT_FALSE(server.is_failed());
+		return *SesameServer::last_instance;
+	}
+	// Lines printed by dump_trace()
+	static std::vector<std::string> dump(SesameServerComponent& server) {
+		std::vector<std::string> lines;
+		test::set_log_sink([&lines](char, const std::string& message) { lines.push_back(message); });
+		server.dump_trace();
+		test::set_log_sink(nullptr);
+		return lines;
+	}
+	// Records some traffic: a remote with a quoted tag and extra bytes, and an unlisted app
+	static void record(SesameServerComponent& server, SesameServer& ble) {
+		ble.sessions.push_back(address(TRIGGER_ADDR));
+		ble.on_connect(address(TRIGGER_ADDR));
+		server.run_deferred();
+		server.advance(20);
+		ble.on_command(address(TRIGGER_ADDR), item_code_t::lock, "alice \"A\"", history_tag_type_t::remote_nano, 2.9f, NAN,
+		               std::string_view{"\x52\xff", 2});
+		server.loop();
+		server.advance(30);
+		ble.on_command(address(APP_ADDR), item_code_t::unlock, "bob", std::nullopt, NAN, NAN, "");
+		server.loop();
+		server.advance(40);
+		ble.sessions.clear();
+		ble.on_disconnect(address(TRIGGER_ADDR), 0x213);
+		server.run_deferred();
+	}
+};
+
+TEST_F(TraceReplayTest, ParsesDumpedRecords) {
+	SesameServerComponent server{3, UUID};
+	SesameTrigger* trig;
+	auto& ble = start(server, trig);
+	record(server, ble);
+	const auto& trace = server.get_trace();
+	ASSERT_GE(trace.size(), 4u);
+
+	std::vector<trace_record_t> parsed;
+	for (const auto& line : dump(server)) {
+		if (auto rec = parse_trace_line(line)) {
+			parsed.push_back(*rec);
+		}
+	}
+	ASSERT_EQ(parsed.size(), trace.size());
+	for (size_t i = 0; i < parsed.size(); i++) {
+		const auto& expected = trace.at(i);
+		EXPECT_EQ(parsed[i].event, expected.event);
+		EXPECT_EQ(parsed[i].address, expected.address);
+		EXPECT_EQ(parsed[i].time_us, expected.time_us);
+		EXPECT_EQ(parsed[i].code, expected.code);
+		EXPECT_EQ(parsed[i].result, expected.result);
+		EXPECT_EQ(parsed[i].history_tag_type, expected.history_tag_type);
+		EXPECT_EQ(parsed[i].get_tag(), expected.get_tag());
+		ASSERT_EQ(parsed[i].extra_len, expected.extra_len);
+		EXPECT_TRUE(std::equal(expected.extra.begin(), expected.extra.begin() + expected.extra_len, parsed[i].extra.begin()));
+	}
+	EXPECT_EQ(parsed[1].get_tag(), "alice \"A\"");
+	EXPECT_FLOAT_EQ(parsed[1].scaled_voltage, 2.9f);
+	EXPECT_TRUE(std::isnan(parsed[1].scaled_voltage2));
+}
+
+TEST_F(TraceReplayTest, ParsesLoggerPrefixAndRejectsOtherLines) {
+	auto rec = parse_trace_line("[12:34:56][I][sesame_server:1600]: T 1000 cc:00:00:00:00:01/1 disconnect 531");
+	ASSERT_TRUE(rec);
+	EXPECT_EQ(rec->event, trace_event_t::disconnect);
+	EXPECT_EQ(rec->address, TRIGGER_KEY);
+	EXPECT_EQ(rec->time_us, 1000u);
+	EXPECT_EQ(rec->result, 531);
+	rec = parse_trace_line("T 2000 cc:00:00:00:00:01/1 lock_state LOCKED 1");
+	ASSERT_TRUE(rec);
+	EXPECT_EQ(rec->code, lock::LOCK_STATE_LOCKED);
+	EXPECT_EQ(rec->result, 1);
+	EXPECT_FALSE(parse_trace_line("Trace: 3 records (0 overwritten)"));
+	EXPECT_FALSE(parse_trace_line("T 2000 cc:00:00:00:00:01/1 unknown"));
+	EXPECT_FALSE(parse_trace_line("T 2000 cc:00:00:00:00:01/1 command 82 2 nan nan alice"));
+}
+
+TEST_F(TraceReplayTest, ReplayReproducesTrace) {
+	std::vector<trace_record_t> recorded;
+	std::vector<std::string> triggered;
+	{
+		SesameServerComponent server{3, UUID};
+		SesameTrigger* trig;
+		auto& ble = start(server, trig);
+		record(server, ble);
+		for (const auto& line : dump(server)) {
+			if (auto rec = parse_trace_line(line)) {
+				recorded.push_back(*rec);
+			}
+		}
+		triggered = trig->triggered;
+	}
+
+	test::set_now_us(5000 * 1000 * 1000ULL);
+	SesameServerComponent server{3, UUID};
+	SesameTrigger* trig;
+	auto& ble = start(server, trig);
+	TraceReplayer replayer{server, ble};
+	for (const auto& rec : recorded) {
+		replayer.feed(rec);
+	}
+	replayer.finish();
+
+	EXPECT_EQ(trig->triggered, triggered);
+	EXPECT_EQ(trig->get_history_tag(), "alice \"A\"");
+	const auto& stats = replayer.get_stats();
+	EXPECT_EQ(stats.records, recorded.size());
+	EXPECT_EQ(stats.connects, 1u);
+	EXPECT_EQ(stats.rejected_connects, 0u);
+	EXPECT_EQ(stats.disconnects, 1u);
+	EXPECT_EQ(stats.commands, 2u);
+	EXPECT_EQ(stats.lock_states_sent, stats.lock_states_recorded);
+
+	// The replayed trace has the same events at the same spacing
+	const auto& replayed = server.get_trace();
+	ASSERT_EQ(replayed.size(), recorded.size());
+	for (size_t i = 0; i < recorded.size(); i++) {
+		EXPECT_EQ(replayed.at(i).event, recorded[i].event);
+		EXPECT_EQ(replayed.at(i).address, recorded[i].address);
+		EXPECT_EQ(replayed.at(i).get_tag(), recorded[i].get_tag());
+		if (i > 0) {
+			EXPECT_EQ(replayed.at(i).time_us - replayed.at(i - 1).time_us, recorded[i].time_us - recorded[i - 1].time_us);
+		}
+	}
+}
+
+}  // namespace
+}  // namespace esphome::sesame_server::replay
@@ -0,0 +1,141 @@
+#include <gtest/gtest.h>
+#include <cmath>
+#include <vector>
+#include "trigger_logic.h"
+
+namespace esphome::sesame_server {
+namespace {
+
+enum class item_code_t : uint8_t { none = 0, lock = 82, unlock = 83, door_open = 90, door_closed = 91 };
+enum class history_tag_type_t : uint8_t { none = 0, open_sensor = 1, remote_nano = 2, ios_app = 0x1d };
+
+constexpr uint8_t OPEN = event_bit(item_code_t::door_open);
+constexpr uint8_t CLOSE = event_bit(item_code_t::door_closed);
+constexpr uint8_t LOCK = event_bit(item_code_t::lock);
+constexpr uint8_t UNLOCK = event_bit(item_code_t::unlock);
+
+TEST(TriggerLogicTest, Fnv1aHash) {
+	// Reference values of 32 bit FNV-1a
+	EXPECT_EQ(fnv1a_hash(""), 2166136261u);
+	EXPECT_EQ(fnv1a_hash("a"), 0xe40c292cu);
+	EXPECT_EQ(fnv1a_hash("foobar"), 0xbf9cf968u);
+}
+
+TEST(TriggerLogicTest, EventBits) {
+	EXPECT_EQ(OPEN, 1);
+	EXPECT_EQ(CLOSE, 2);
+	EXPECT_EQ(LOCK, 4);
+	EXPECT_EQ(UNLOCK, 8);
+	EXPECT_EQ(event_bit(item_code_t::none), 0);
+}
+
+TEST(TriggerLogicTest, BatteryModel) {
+	EXPECT_EQ(battery_model(history_tag_type_t::open_sensor), battery_model_t::open_sensor);
+	EXPECT_EQ(battery_model(history_tag_type_t::remote_nano), battery_model_t::open_sensor);
+	EXPECT_EQ(battery_model(history_tag_type_t::ios_app), battery_model_t::sesame_5);
+	EXPECT_EQ(battery_model(history_tag_type_t::none), battery_model_t::sesame_5);
+}
+
+TEST(TriggerLogicTest, FloatChanged) {
+	EXPECT_TRUE(float_changed(NAN, 1.0f, 0.0f));
+	EXPECT_TRUE(float_changed(1.0f, NAN, 0.0f));
+	EXPECT_FALSE(float_changed(NAN, NAN, 0.0f));
+	EXPECT_FALSE(float_changed(1.0f, 1.0f, 0.0f));
+	EXPECT_TRUE(float_changed(1.0f, 1.01f, 0.0f));
+	EXPECT_FALSE(float_changed(1.0f, 1.125f, 0.25f));
+	EXPECT_TRUE(float_changed(1.0f, 1.25f, 0.25f));
+	EXPECT_TRUE(float_changed(1.0f, 0.5f, 0.25f));
+}
+
+TEST(DedupFilterTest, DisabledByDefault) {
+	DedupFilter dedup;
+	EXPECT_FALSE(dedup.is_duplicate(1, 0, 0));
+	EXPECT_FALSE(dedup.is_duplicate(1, 0, 0));
+	EXPECT_EQ(dedup.get_suppressed_count(), 0u);
+}
+
+TEST(DedupFilterTest, SuppressesRepeatWithinWindow) {
+	DedupFilter dedup;
+	dedup.set_window(1000);
+	auto tag = fnv1a_hash("alice");
+	EXPECT_FALSE(dedup.is_duplicate(82, tag, 5000));
+	EXPECT_TRUE(dedup.is_duplicate(82, tag, 5999));
+	// the window starts at the last accepted command
+	EXPECT_FALSE(dedup.is_duplicate(82, tag, 6000));
+	EXPECT_EQ(dedup.get_suppressed_count(), 1u);
+}
+
+TEST(DedupFilterTest, DifferentCommandOrTagPasses) {
+	DedupFilter dedup;
+	dedup.set_window(1000);
+	EXPECT_FALSE(dedup.is_duplicate(82, fnv1a_hash("alice"), 0));
+	EXPECT_FALSE(dedup.is_duplicate(83, fnv1a_hash("alice"), 10));
+	EXPECT_FALSE(dedup.is_duplicate(83, fnv1a_hash("bob"), 20));
+	EXPECT_TRUE(dedup.is_duplicate(83, fnv1a_hash("bob"), 30));
+}
+
+TEST(DedupFilterTest, MillisWrapAround) {
+	DedupFilter dedup;
+	dedup.set_window(1000);
+	EXPECT_FALSE(dedup.is_duplicate(82, 0, UINT32_MAX - 100));
+	EXPECT_TRUE(dedup.is_duplicate(82, 0, 500));
+	EXPECT_FALSE(dedup.is_duplicate(82, 0, 1000));
+}
+
+class RouteTableTest : public ::testing::Test {
+ protected:
+	void add(int target, const char* tag, uint8_t mask, int16_t type = -1) {
+		routes.add(tag ? fnv1a_hash(tag) : 0, tag, mask, type, target);
+	}
+	std::vector<int> dispatch(item_code_t cmd, std::string_view tag, int16_t type = -1) const {
+		std::vector<int> hits;
+		routes.dispatch(event_bit(cmd), tag, type, [&hits](int target) { hits.push_back(target); });
+		return hits;
+	}
+
+	RouteTable<int> routes;
+};
+
+TEST_F(RouteTableTest, EmptyTableDispatchesNothing) {
+	EXPECT_TRUE(routes.empty());
+	EXPECT_TRUE(dispatch(item_code_t::lock, "alice").empty());
+}
+
+TEST_F(RouteTableTest, EventMask) {
+	add(1, nullptr, LOCK | UNLOCK);
+	add(2, nullptr, OPEN);
+	EXPECT_EQ(dispatch(item_code_t::lock, ""), std::vector<int>{1});
+	EXPECT_EQ(dispatch(item_code_t::unlock, ""), std::vector<int>{1});
+	EXPECT_EQ(dispatch(item_code_t::door_open, ""), std::vector<int>{2});
+	EXPECT_TRUE(dispatch(item_code_t::door_closed, "").empty());
+	EXPECT_TRUE(dispatch(item_code_t::none, "").empty());
+}
+
+TEST_F(RouteTableTest, TaggedRoutesMatchExactTagBeforeUntagged) {
+	add(1, nullptr, LOCK);
+	add(2, "bob", LOCK);
+	add(3, "alice", LOCK);
+	add(4, "alice", UNLOCK);
+	EXPECT_EQ(routes.size(), 4u);
+	EXPECT_EQ(dispatch(item_code_t::lock, "alice"), (std::vector<int>{3, 1}));
+	EXPECT_EQ(dispatch(item_code_t::unlock, "alice"), std::vector<int>{4});
+	EXPECT_EQ(dispatch(item_code_t::lock, "bob"), (std::vector<int>{2, 1}));
+	EXPECT_EQ(dispatch(item_code_t::lock, "carol"), std::vector<int>{1});
+}
+
+TEST_F(RouteTableTest, HashCollisionComparesTag) {
+	// A route whose tag hashes like "alice" must not fire for "alice"
+	routes.add(fnv1a_hash("alice"), "mallory", LOCK, -1, 1);
+	EXPECT_TRUE(dispatch(item_code_t::lock, "alice").empty());
+}
+
+TEST_F(RouteTableTest, HistoryTagType) {
+	add(1, nullptr, LOCK, static_cast<int16_t>(history_tag_type_t::remote_nano));
+	add(2, nullptr, LOCK);
+	EXPECT_EQ(dispatch(item_code_t::lock, "", static_cast<int16_t>(history_tag_type_t::remote_nano)), (std::vector<int>{1, 2}));
+	EXPECT_EQ(dispatch(item_code_t::lock, "", static_cast<int16_t>(history_tag_type_t::ios_app)), std::vector<int>{2});
+	EXPECT_EQ(dispatch(item_code_t::lock, "", -1), std::vector<int>{2});
+}
+
+}  // namespace
+}  // namespace esphome::sesame_server
@@ -0,0 +1,52 @@
+#include <gtest/gtest.h>
+#include <cmath>
+#include "sesame_server_component.h"
+
+namespace esphome::sesame_server {
+namespace {
+
+using libsesame3bt::history_tag_type_t;
+using libsesame3bt::Sesame;
+using libsesame3bt::SesameServer;
+using item_code_t = Sesame::item_code_t;
+
+constexpr const char UUID[] = "6ab3d2ca-7b5e-4c38-b5c4-2a1bd26f9d01";
+constexpr uint64_t TRIGGER_KEY = 0x0001'cc00'0000'0001;
+
+class WithoutApiTest : public ::testing::Test {
+ protected:
+	void SetUp() override {
+		test::set_now_us(1000 * 1000 * 1000);
+		global_preferences->slots.clear();
+	}
+	// This build runs the worker task, which uses the component
+	void TearDown() override { test::stop_tasks(); }
+
+	SesameServerComponent server{3, UUID};
+};
+
+TEST_F(WithoutApiTest, AggregateEventPublishesSensorsDirectly) {
+	// No event can carry the values, deferring the sensors would lose them
+	auto* trig = new SesameTrigger(&server, TRIGGER_KEY);
+	trig->set_name("remote");
+	sensor::Sensor voltage_sensor;
+	trig->set_scaled_voltage_sensor(&voltage_sensor);
+	trig->set_aggregate_event(true);
+	server.add_trigger(trig);
+	server.set_aggregate_sensor_interval(10 * 1000);
+	server.setup();
+	ASSERT_FALSE(server.is_failed());
+	auto& ble = *SesameServer::last_instance;
+	ble.on_command(trig->get_address(), item_code_t::lock, "", history_tag_type_t::remote_nano, 2.9f, NAN, "");
+	server.loop();
+	EXPECT_EQ(voltage_sensor.publish_count, 1u);
+	EXPECT_FLOAT_EQ(voltage_sensor.state, 2.9f);
+	ble.on_command(trig->get_address(), item_code_t::unlock, "", history_tag_type_t::remote_nano, 2.8f, NAN, "");
+	server.loop();
+	EXPECT_EQ(voltage_sensor.publish_count, 2u);
+	EXPECT_FLOAT_EQ(voltage_sensor.state, 2.8f);
+	EXPECT_EQ(trig->triggered, (std::vector<std::string>{"lock", "unlock"}));
+}
+
+}  // namespace
+}  // namespace esphome::sesame_server
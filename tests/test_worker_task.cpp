@@ -0,0 +1,104 @@
+#include <gtest/gtest.h>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <string>
+#include <thread>
+#include "sesame_server_component.h"
+
+namespace esphome::sesame_server {
+namespace {
+
+using libsesame3bt::Sesame;
+using libsesame3bt::SesameServer;
+using item_code_t = Sesame::item_code_t;
+
+constexpr const char UUID[] = "6ab3d2ca-7b5e-4c38-b5c4-2a1bd26f9d01";
+constexpr uint64_t TRIGGER_KEY = 0x0001'cc00'0000'0001;
+
+class WorkerTaskTest : public ::testing::Test {
+ protected:
+	void SetUp() override {
+		test::set_now_us(1000 * 1000 * 1000);
+		global_preferences->slots.clear();
+		trig = new SesameTrigger(&server, TRIGGER_KEY);
+		trig->set_name("remote");
+		server.add_trigger(trig);
+	}
+	// The worker task uses the component, it must end first
+	void TearDown() override { test::stop_tasks(); }
+	SesameServer& start() {
+		server.setup();
+		EXPECT_FALSE(server.is_failed());
+		return *SesameServer::last_instance;
+	}
+
+	SesameServerComponent server{3, UUID};
+	SesameTrigger* trig;
+};
+
+TEST_F(WorkerTaskTest, CommandWakesWorker) {
+	// Longer than the test, only a notification can wake the worker
+	server.set_worker_task(1, 5, 8192, 60 * 1000);
+	auto& ble = start();
+	auto wait_iterations = [this](uint32_t count) {
+		for (int i = 0; i < 1000 && server.get_worker_iterations() < count; i++) {
+			std::this_thread::sleep_for(std::chrono::milliseconds{1});
+		}
+		return server.get_worker_iterations();
+	};
+	ASSERT_GE(wait_iterations(1), 1u);
+	std::this_thread::sleep_for(std::chrono::milliseconds{20});
+	auto iterations = server.get_worker_iterations();
+	ble.on_command(trig->get_address(), item_code_t::lock, "alice", std::nullopt, NAN, NAN, "");
+	EXPECT_GT(wait_iterations(iterations + 1), iterations);
+	server.loop();
+	EXPECT_EQ(trig->triggered, std::vector<std::string>{"lock"});
+}
+
+TEST_F(WorkerTaskTest, ConcurrentCommandsAreDeliveredInOrder) {
+	constexpr uint32_t COMMANDS = 20000;
+	server.set_worker_task(1, 5, 8192, 1);
+	server.set_event_history_size(COMMANDS);
+	auto& ble = start();
+	auto addr = trig->get_address();
+
+	// Stands in for the NimBLE host task, the only producer of the command queue
+	std::atomic<bool> done{false};
+	std::thread producer{[&]() {
+		for (uint32_t i = 0; i < COMMANDS; i++) {
+			ble.on_command(addr, i % 2 ? item_code_t::unlock : item_code_t::lock, std::to_string(i), std::nullopt, NAN, NAN,
+			               std::string_view{reinterpret_cast<const char*>(&i), sizeof(i)});
+		}
+		done = true;
+	}};
+	while (!done) {
+		server.loop();
+	}
+	producer.join();
+	server.loop();
+
+	auto overflows = server.get_command_overflow_count();
+	const auto& history = server.get_event_history();
+	EXPECT_EQ(history.size() + overflows, COMMANDS);
+	EXPECT_EQ(trig->triggered.size(), history.size());
+	EXPECT_GT(history.size(), 0u);
+	// Each delivered command arrives once, whole and in order, whatever was dropped on overflow
+	int64_t last = -1;
+	for (size_t i = 0; i < history.size(); i++) {
+		const auto& rec = history.at(i);
+		auto n = std::stoll(std::string{rec.get_tag()});
+		ASSERT_GT(n, last);
+		EXPECT_EQ(rec.item_code, static_cast<uint8_t>(n % 2 ? item_code_t::unlock : item_code_t::lock));
+		last = n;
+	}
+	auto extra = trig->get_extra_bytes();
+	ASSERT_EQ(extra.size(), sizeof(uint32_t));
+	uint32_t last_extra;
+	std::memcpy(&last_extra, extra.data(), sizeof(last_extra));
+	EXPECT_EQ(last_extra, last);
+	EXPECT_GT(server.get_worker_iterations(), 0u);
+}
+
+}  // namespace
+}  // namespace esphome::sesame_server
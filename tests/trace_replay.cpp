@@ -0,0 +1,182 @@
+#include "trace_replay.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+namespace esphome::sesame_server::replay {
+
+using libsesame3bt::history_tag_type_t;
+using libsesame3bt::Sesame;
+
+namespace {
+
+std::optional<uint8_t>
+parse_hex_byte(std::string_view str) {
+	if (str.size() < 2) {
+		return std::nullopt;
+	}
+	unsigned v;
+	if (std::sscanf(std::string{str.substr(0, 2)}.c_str(), "%2x", &v) != 1) {
+		return std::nullopt;
+	}
+	return v;
+}
+
+std::optional<lock::LockState>
+parse_lock_state(std::string_view name) {
+	for (uint8_t i = lock::LOCK_STATE_NONE; i <= lock::LOCK_STATE_UNLOCKING; i++) {
+		auto state = static_cast<lock::LockState>(i);
+		if (name == lock::lock_state_to_string(state)) {
+			return state;
+		}
+	}
+	return std::nullopt;
+}
+
+NimBLEAddress
+to_address(uint64_t key) {
+	ble_addr_t addr{};
+	addr.type = static_cast<uint8_t>(key >> 48);
+	for (size_t i = 0; i < std::size(addr.val); i++) {
+		addr.val[i] = static_cast<uint8_t>(key >> (i * 8));
+	}
+	return addr;
+}
+
+}  // namespace
+
+std::optional<trace_record_t>
+parse_trace_line(std::string_view line) {
+	// The logger prefix ends with ": "
+	if (auto pos = line.find(": T "); pos != std::string_view::npos) {
+		line.remove_prefix(pos + 2);
+	}
+	if (line.substr(0, 2) != "T ") {
+		return std::nullopt;
+	}
+	std::string str{line};
+	trace_record_t rec{};
+	rec.history_tag_type = 0xff;
+	rec.scaled_voltage = NAN;
+	rec.scaled_voltage2 = NAN;
+	unsigned time_us, a[6], type;
+	char event[16];
+	int consumed;
+	if (std::sscanf(str.c_str(), "T %u %2x:%2x:%2x:%2x:%2x:%2x/%u %15s %n", &time_us, &a[0], &a[1], &a[2], &a[3], &a[4], &a[5],
+	                &type, event, &consumed) != 9) {
+		return std::nullopt;
+	}
+	rec.time_us = time_us;
+	rec.address = type;
+	for (auto v : a) {
+		rec.address = (rec.address << 8) | v;
+	}
+	std::string_view args{line.substr(consumed)};
+	std::string event_name{event};
+	if (event_name == "connect") {
+		rec.event = trace_event_t::connect;
+	} else if (event_name == "disconnect") {
+		rec.event = trace_event_t::disconnect;
+		rec.result = std::atoi(std::string{args}.c_str());
+	} else if (event_name == "lock_state") {
+		rec.event = trace_event_t::lock_state;
+		auto space = args.find(' ');
+		auto state = parse_lock_state(args.substr(0, space));
+		if (!state || space == std::string_view::npos) {
+			return std::nullopt;
+		}
+		rec.code = *state;
+		rec.result = std::atoi(std::string{args.substr(space + 1)}.c_str());
+	} else if (event_name == "command") {
+		rec.event = trace_event_t::command;
+		unsigned code, history_tag_type;
+		if (std::sscanf(std::string{args}.c_str(), "%u %u %f %f", &code, &history_tag_type, &rec.scaled_voltage,
+		                &rec.scaled_voltage2) != 4) {
+			return std::nullopt;
+		}
+		rec.code = code;
+		rec.history_tag_type = history_tag_type;
+		// The tag may contain quotes and spaces, it runs up to the last quote
+		auto open = args.find('"');
+		auto close = args.rfind('"');
+		if (open == std::string_view::npos || close == open) {
+			return std::nullopt;
+		}
+		auto tag = args.substr(open + 1, std::min(close - open - 1, rec.tag.size()));
+		rec.tag_len = tag.size();
+		std::copy(tag.cbegin(), tag.cend(), rec.tag.begin());
+		auto extra = args.substr(close + 1);
+		extra.remove_prefix(std::min(extra.find_first_not_of(' '), extra.size()));
+		while (extra.size() >= 2 && rec.extra_len < rec.extra.size()) {
+			auto v = parse_hex_byte(extra);
+			if (!v) {
+				return std::nullopt;
+			}
+			rec.extra[rec.extra_len++] = static_cast<std::byte>(*v);
+			extra.remove_prefix(2);
+		}
+	} else {
+		return std::nullopt;
+	}
+	return rec;
+}
+
+void
+TraceReplayer::feed(const trace_record_t& rec) {
+	if (last_time_us) {
+		// micros() wraps around, the spacing is still right
+		uint32_t elapsed_us = rec.time_us - *last_time_us;
+		server.advance(elapsed_us / 1000);
+		test::advance_us(elapsed_us % 1000);
+	}
+	last_time_us = rec.time_us;
+	stats.records++;
+	auto addr = to_address(rec.address);
+	switch (rec.event) {
+		case trace_event_t::connect:
+			if (!ble.connect_check || !ble.connect_check(addr)) {
+				stats.rejected_connects++;
+				break;
+			}
+			stats.connects++;
+			ble.sessions.push_back(addr);
+			ble.on_connect(addr);
+			break;
+		case trace_event_t::disconnect:
+			if (!ble.has_session(addr)) {
+				break;
+			}
+			stats.disconnects++;
+			ble.sessions.erase(std::remove(ble.sessions.begin(), ble.sessions.end(), addr), ble.sessions.end());
+			ble.on_disconnect(addr, rec.result);
+			break;
+		case trace_event_t::command: {
+			stats.commands++;
+			std::optional<history_tag_type_t> history_tag_type;
+			if (rec.history_tag_type != 0xff) {
+				history_tag_type = static_cast<history_tag_type_t>(rec.history_tag_type);
+			}
+			ble.on_command(addr, static_cast<Sesame::item_code_t>(rec.code), std::string{rec.get_tag()}, history_tag_type,
+			               rec.scaled_voltage, rec.scaled_voltage2,
+			               {reinterpret_cast<const char*>(rec.extra.data()), rec.extra_len});
+			break;
+		}
+		case trace_event_t::lock_state:
+			stats.lock_states_recorded++;
+			break;
+	}
+	server.run_deferred();
+	server.loop();
+	stats.lock_states_sent = ble.sent.size() - sent_before;
+}
+
+void
+TraceReplayer::finish(uint32_t ms) {
+	server.advance(ms);
+	server.loop();
+	stats.lock_states_sent = ble.sent.size() - sent_before;
+}
+
+}  // namespace esphome::sesame_server::replay
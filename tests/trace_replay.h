@@ -0,0 +1,44 @@
+#pragma once
+// Replays a trace printed by SesameServerComponent::dump_trace() through the callbacks of a host build of the component,
+// so that field incidents can be reproduced and fixes measured against recorded traffic.
+#include <cstdint>
+#include <optional>
+#include <string_view>
+#include "sesame_server_component.h"
+
+namespace esphome::sesame_server::replay {
+
+// Parses one "T <time_us> <address>/<type> <event> ..." line of dump_trace(), with or without the logger prefix.
+std::optional<trace_record_t> parse_trace_line(std::string_view line);
+
+struct replay_stats_t {
+	uint32_t records;
+	uint32_t connects;
+	uint32_t rejected_connects;  // refused by the connect check of the replayed component
+	uint32_t disconnects;
+	uint32_t commands;
+	uint32_t lock_states_recorded;  // lock state sends found in the trace
+	uint32_t lock_states_sent;      // lock state sends of the replayed component
+};
+
+// Feeds trace records to a set up component. Records are replayed at their recorded spacing on the fake clock, running
+// the component loop and timers in between. Lock state records are outputs, they are only counted for comparison.
+class TraceReplayer {
+ public:
+	// `ble` is the stand-in SesameServer owned by `server`
+	TraceReplayer(SesameServerComponent& server, libsesame3bt::SesameServer& ble)
+	    : server(server), ble(ble), sent_before(ble.sent.size()) {}
+	void feed(const trace_record_t& rec);
+	// Runs the component for `ms` after the last record, to let pending deliveries complete
+	void finish(uint32_t ms = 1000);
+	const replay_stats_t& get_stats() const { return stats; }
+
+ private:
+	SesameServerComponent& server;
+	libsesame3bt::SesameServer& ble;
+	size_t sent_before;
+	std::optional<uint32_t> last_time_us;
+	replay_stats_t stats{};
+};
+
+}  // namespace esphome::sesame_server::replay